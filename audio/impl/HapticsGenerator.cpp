@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "HapticsGenerator"
+
+#include "core/default/HapticsGenerator.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/system_properties.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <cstring>
+
+#include <android/log.h>
+#include <system/audio.h>
+#include <utils/SystemClock.h>
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace CPP_VERSION {
+namespace implementation {
+
+static constexpr char kExternalControlProp[] = "vendor.vibrator.external_control";
+static constexpr char kEnablePath[] = "/sys/class/timed_output/vibrator/enable";
+static constexpr char kIntensityPath[] = "/sys/class/timed_output/vibrator/intensity";
+
+// How often levels are picked up while audible, often enough to extend every slice
+static constexpr int kPollMs = MotorSlice::kSliceMs / 2;
+
+static bool writeValue(int fd, int64_t value) {
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf) - 1, value);
+    *end++ = '\n';
+
+    return pwrite(fd, buf, end - buf, 0) >= 0;
+}
+
+std::unique_ptr<HapticsGenerator> HapticsGenerator::create(audio_stream_out_t* stream) {
+    audio_channel_mask_t mask = stream->common.get_channels(&stream->common);
+    if ((mask & AUDIO_CHANNEL_HAPTIC_ALL) == 0 ||
+        stream->common.get_format(&stream->common) != AUDIO_FORMAT_PCM_16_BIT) {
+        return nullptr;
+    }
+
+    return std::unique_ptr<HapticsGenerator>(new HapticsGenerator(
+            stream->common.get_sample_rate(&stream->common),
+            audio_channel_count_from_out_mask(mask)));
+}
+
+HapticsGenerator::HapticsGenerator(uint32_t sampleRate, uint32_t channelCount)
+    : mSampleRate(sampleRate),
+      mChannelCount(channelCount),
+      mWakeFd(eventfd(0, EFD_CLOEXEC)),
+      mEnableFd(open(kEnablePath, O_WRONLY | O_CLOEXEC)),
+      mIntensityFd(open(kIntensityPath, O_WRONLY | O_CLOEXEC)) {
+    if (!mWakeFd.ok() || !mEnableFd.ok() || !mIntensityFd.ok()) {
+        ALOGE("failed to set up the vibrator thread: %s", strerror(errno));
+        return;
+    }
+
+    mThread = std::thread(&HapticsGenerator::run, this);
+}
+
+HapticsGenerator::~HapticsGenerator() {
+    if (!mThread.joinable()) return;
+
+    mExit = true;
+    eventfd_write(mWakeFd.get(), 1);
+    mThread.join();
+}
+
+void HapticsGenerator::process(const void* buffer, size_t bytes) {
+    size_t samples = bytes / sizeof(int16_t);
+    if (samples < mChannelCount) return;
+
+    float level = mEnvelope.process(static_cast<const int16_t*>(buffer), samples, mChannelCount,
+                                    mSampleRate);
+
+    // The vibrator thread only needs the latest levels, dropping on overflow is fine
+    mLevels.push(level);
+
+    // No syscall per buffer: wake the thread only if it sleeps while there is
+    // something to play, or to stop the motor as soon as audio goes quiet.
+    // Missing an idle flag that is being set only delays it by one buffer.
+    bool audible = level >= kHapticsThreshold;
+    bool wake = audible ? mVibratorIdle.load(std::memory_order_relaxed) &&
+                                  mVibratorIdle.exchange(false)
+                        : mAudible;
+    mAudible = audible;
+
+    if (wake) eventfd_write(mWakeFd.get(), 1);
+}
+
+void HapticsGenerator::run() {
+    bool idle = true;
+
+    while (true) {
+        mVibratorIdle = idle;
+
+        struct pollfd pfd = {.fd = mWakeFd.get(), .events = POLLIN, .revents = 0};
+        int ret = poll(&pfd, 1, idle ? -1 : kPollMs);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            ALOGE("failed to wait for levels: %s", strerror(errno));
+            break;
+        }
+        if (ret > 0) {
+            eventfd_t count;
+            eventfd_read(mWakeFd.get(), &count);
+        }
+        if (mExit) break;
+
+        float level;
+        bool haveLevel = false;
+        while (mLevels.pop(&level)) haveLevel = true;
+
+        // Audio stalled, the current slice runs out on its own
+        if (!haveLevel) {
+            idle = true;
+            continue;
+        }
+
+        if (level < kHapticsThreshold) {
+            stop();
+            idle = true;
+            continue;
+        }
+
+        // Keep polling while audible, external control may be handed over any time
+        idle = false;
+        if (!externalControl()) {
+            stop();
+            continue;
+        }
+
+        drive(level);
+    }
+
+    stop();
+}
+
+bool HapticsGenerator::externalControl() {
+    // The property only exists once the vibrator HAL has set it
+    if (mExternalControlProp == nullptr) {
+        mExternalControlProp = __system_property_find(kExternalControlProp);
+        if (mExternalControlProp == nullptr) return false;
+    }
+
+    // Only read the value again when it has changed
+    uint32_t serial = __system_property_serial(mExternalControlProp);
+    if (serial != mExternalControlSerial) {
+        mExternalControlSerial = serial;
+        __system_property_read_callback(
+                mExternalControlProp,
+                [](void* cookie, const char*, const char* value, uint32_t) {
+                    *static_cast<bool*>(cookie) = strcmp(value, "1") == 0;
+                },
+                &mExternalControl);
+    }
+
+    return mExternalControl;
+}
+
+void HapticsGenerator::drive(float level) {
+    uint32_t intensity = hapticsIntensity(level);
+
+    if (intensity != mIntensity && writeValue(mIntensityFd.get(), intensity)) {
+        mIntensity = intensity;
+    }
+
+    int64_t now = elapsedRealtimeNano();
+    if (mSlice.needsExtending(now) && writeValue(mEnableFd.get(), MotorSlice::kSliceMs)) {
+        mSlice.extend(now);
+    }
+}
+
+void HapticsGenerator::stop() {
+    // Once external control is released the vibrator HAL owns the nodes again,
+    // and a slice that already ran out needs no stopping
+    if (mSlice.isRunning(elapsedRealtimeNano()) && externalControl()) {
+        writeValue(mEnableFd.get(), 0);
+    }
+
+    mSlice.reset();
+    // The vibrator HAL may write the node in between
+    mIntensity = 0;
+}
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
@@ -17,6 +17,7 @@
 #define LOG_TAG "StreamOutHAL"
 
 #include "core/default/StreamOut.h"
+#include "core/default/HapticsGenerator.h"
 #include "core/default/Util.h"
 
 //#define LOG_NDEBUG 0
@@ -52,7 +53,7 @@ class WriteThread : public Thread {
     // WriteThread's lifespan never exceeds StreamOut's lifespan.
     WriteThread(std::atomic<bool>* stop, audio_stream_out_t* stream,
                 StreamOut::CommandMQ* commandMQ, StreamOut::DataMQ* dataMQ,
-                StreamOut::StatusMQ* statusMQ, EventFlag* efGroup)
+                StreamOut::StatusMQ* statusMQ, EventFlag* efGroup, HapticsGenerator* haptics)
         : Thread(false /*canCallJava*/),
           mStop(stop),
           mStream(stream),
@@ -60,6 +61,7 @@ class WriteThread : public Thread {
           mDataMQ(dataMQ),
           mStatusMQ(statusMQ),
           mEfGroup(efGroup),
+          mHaptics(haptics),
           mBuffer(nullptr) {}
     bool init() {
         mBuffer.reset(new (std::nothrow) uint8_t[mDataMQ->getQuantumCount()]);
@@ -74,6 +76,7 @@ class WriteThread : public Thread {
     StreamOut::DataMQ* mDataMQ;
     StreamOut::StatusMQ* mStatusMQ;
     EventFlag* mEfGroup;
+    HapticsGenerator* mHaptics;
     std::unique_ptr<uint8_t[]> mBuffer;
     IStreamOut::WriteStatus mStatus;
 
@@ -92,6 +95,8 @@ void WriteThread::doWrite() {
         ssize_t writeResult = mStream->write(mStream, &mBuffer[0], availToRead);
         if (writeResult >= 0) {
             mStatus.reply.written = writeResult;
+            // After the write, so that it adds nothing to the audio latency
+            if (mHaptics) mHaptics->process(&mBuffer[0], writeResult);
         } else {
             mStatus.retval = Stream::analyzeStatus("write", writeResult);
         }
@@ -402,9 +407,10 @@ Return<void> StreamOut::prepareForWriting(uint32_t frameSize, uint32_t framesCou
     }
 
     // Create and launch the thread.
+    mHaptics = HapticsGenerator::create(mStream);
     auto tempWriteThread =
             sp<WriteThread>::make(&mStopWriteThread, mStream, tempCommandMQ.get(), tempDataMQ.get(),
-                                  tempStatusMQ.get(), tempElfGroup.get());
+                                  tempStatusMQ.get(), tempElfGroup.get(), mHaptics.get());
     if (!tempWriteThread->init()) {
         ALOGW("failed to start writer thread: %s", strerror(-status));
         sendError(Result::INVALID_ARGUMENTS);
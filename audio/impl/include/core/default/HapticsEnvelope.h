@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ANDROID_HARDWARE_AUDIO_HAPTICSENVELOPE_H
+#define ANDROID_HARDWARE_AUDIO_HAPTICSENVELOPE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "core/default/PcmLevel.h"
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace CPP_VERSION {
+namespace implementation {
+
+// Levels below this leave the motor off
+constexpr float kHapticsThreshold = 0.05f;
+
+// Same range as the vibrator HAL
+constexpr uint32_t kHapticsIntensityMin = 30;
+constexpr uint32_t kHapticsIntensityMax = 10000;
+
+inline uint32_t hapticsIntensity(float level) {
+    float clamped = std::clamp(level, 0.0f, 1.0f);
+    return kHapticsIntensityMin +
+           std::lround(clamped * (kHapticsIntensityMax - kHapticsIntensityMin));
+}
+
+/*
+ * One-pole follower over the peak of each buffer: quick to rise so hits are
+ * not late, slow to fall so the motor does not chatter between them.
+ */
+class EnvelopeFollower {
+  public:
+    // Takes one interleaved 16 bit buffer and returns the new level
+    float process(const int16_t* samples, size_t count, uint32_t channelCount,
+                  uint32_t sampleRate) {
+        size_t frames = channelCount == 0 ? 0 : count / channelCount;
+        if (frames == 0 || sampleRate == 0) return mLevel;
+
+        float peak = peakAbs(samples, count) / float(INT16_MAX);
+        float dt = float(frames) / sampleRate;
+        float tau = peak > mLevel ? kAttackSec : kReleaseSec;
+        mLevel += (peak - mLevel) * (1.0f - std::exp(-dt / tau));
+
+        return mLevel;
+    }
+
+    float level() const { return mLevel; }
+
+  private:
+    static constexpr float kAttackSec = 0.005f;
+    static constexpr float kReleaseSec = 0.060f;
+
+    float mLevel{0};
+};
+
+/*
+ * The motor is kept running in slices, so it stops on its own if audio does.
+ * Times are elapsedRealtimeNano().
+ */
+class MotorSlice {
+  public:
+    static constexpr int64_t kSliceMs = 50;
+
+    // Extend the current slice before it runs out, not on every level
+    bool needsExtending(int64_t nowNs) const {
+        return mRunningUntilNs - nowNs < kSliceMs * kNsPerMs / 2;
+    }
+
+    void extend(int64_t nowNs) { mRunningUntilNs = nowNs + kSliceMs * kNsPerMs; }
+
+    bool isRunning(int64_t nowNs) const { return mRunningUntilNs > nowNs; }
+
+    void reset() { mRunningUntilNs = 0; }
+
+  private:
+    static constexpr int64_t kNsPerMs = 1000 * 1000;
+
+    int64_t mRunningUntilNs{0};
+};
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_AUDIO_HAPTICSENVELOPE_H
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ANDROID_HARDWARE_AUDIO_HAPTICSGENERATOR_H
+#define ANDROID_HARDWARE_AUDIO_HAPTICSGENERATOR_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <android-base/unique_fd.h>
+#include <SpscQueue.h>
+#include <hardware/audio.h>
+#include <sys/system_properties.h>
+
+#include "core/default/HapticsEnvelope.h"
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace CPP_VERSION {
+namespace implementation {
+
+/*
+ * Drives the vibrator from the envelope of a haptic-capable output stream
+ * while the vibrator HAL has handed over external control.
+ *
+ * process() runs on the write thread after each buffer has been written to
+ * the HAL. It only measures the buffer and pushes one level into a wait-free
+ * queue; all sysfs writes happen on a thread of its own. That thread picks
+ * the levels up on a timer while anything is audible and sleeps otherwise,
+ * so the write thread only signals its eventfd to wake it up or to stop the
+ * motor right away.
+ */
+class HapticsGenerator {
+  public:
+    // Returns nullptr unless the stream carries haptic channels in 16 bit PCM
+    static std::unique_ptr<HapticsGenerator> create(audio_stream_out_t* stream);
+    ~HapticsGenerator();
+
+    void process(const void* buffer, size_t bytes);
+
+  private:
+    HapticsGenerator(uint32_t sampleRate, uint32_t channelCount);
+
+    void run();
+    // Cached vendor.vibrator.external_control
+    bool externalControl();
+    void drive(float level);
+    void stop();
+
+    const uint32_t mSampleRate;
+    const uint32_t mChannelCount;
+
+    // Only touched on the write thread
+    EnvelopeFollower mEnvelope;
+    bool mAudible{false};
+
+    SpscQueue<float, 64> mLevels;
+    android::base::unique_fd mWakeFd;
+    // Set while the vibrator thread sleeps without a timeout
+    std::atomic<bool> mVibratorIdle{false};
+
+    // Only touched on the vibrator thread
+    android::base::unique_fd mEnableFd;
+    android::base::unique_fd mIntensityFd;
+    uint32_t mIntensity{0};
+    MotorSlice mSlice;
+    const prop_info* mExternalControlProp{nullptr};
+    uint32_t mExternalControlSerial{0};
+    bool mExternalControl{false};
+
+    std::atomic<bool> mExit{false};
+    std::thread mThread;
+};
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_AUDIO_HAPTICSGENERATOR_H
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ANDROID_HARDWARE_AUDIO_PCMLEVEL_H
+#define ANDROID_HARDWARE_AUDIO_PCMLEVEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace CPP_VERSION {
+namespace implementation {
+
+// Reference for peakAbs(), which also uses it for what is left after the vector loop
+inline int16_t peakAbsScalar(const int16_t* samples, size_t count, int16_t peak = 0) {
+    for (size_t i = 0; i < count; i++) {
+        int16_t sample = std::max<int16_t>(samples[i], -INT16_MAX);
+        peak = std::max<int16_t>(peak, static_cast<int16_t>(std::abs(sample)));
+    }
+
+    return peak;
+}
+
+/*
+ * Largest absolute sample of an interleaved 16 bit buffer, with all channels
+ * folded together. Saturating, so -32768 counts as 32767.
+ */
+inline int16_t peakAbs(const int16_t* samples, size_t count) {
+    size_t i = 0;
+    int16_t peak = 0;
+
+#if defined(__aarch64__)
+    int16x8_t vpeak = vdupq_n_s16(0);
+    for (; i + 8 <= count; i += 8) {
+        vpeak = vmaxq_s16(vpeak, vqabsq_s16(vld1q_s16(samples + i)));
+    }
+    peak = vmaxvq_s16(vpeak);
+#endif
+
+    return peakAbsScalar(samples + i, count - i, peak);
+}
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_AUDIO_PCMLEVEL_H
@@ -20,6 +20,7 @@
 #include PATH(android/hardware/audio/FILE_VERSION/IStreamOut.h)
 
 #include "Device.h"
+#include "HapticsGenerator.h"
 #include "Stream.h"
 
 #include <atomic>
@@ -179,6 +180,8 @@ struct StreamOut : public IStreamOut {
     EventFlag* mEfGroup;
     std::atomic<bool> mStopWriteThread;
     sp<Thread> mWriteThread;
+    // Outlives the write thread, which is joined in the destructor
+    std::unique_ptr<HapticsGenerator> mHaptics;
 
     virtual ~StreamOut();
 
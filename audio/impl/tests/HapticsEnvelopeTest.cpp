@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/default/HapticsEnvelope.h"
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace CPP_VERSION {
+namespace implementation {
+
+static constexpr uint32_t kSampleRate = 48000;
+static constexpr uint32_t kChannels = 2;
+// 10ms buffers, as a fast output writes them
+static constexpr size_t kBufferFrames = 480;
+static constexpr int64_t kNsPerMs = 1000 * 1000;
+
+/*
+ * tests/data/haptics_burst.pcm: 16 bit little endian, 48kHz, one audio and one
+ * haptic channel interleaved. 40ms of noise, an 80ms burst with 5ms ramps at
+ * 0.8 on the haptic channel and 0.3 on the audio one, then 240ms of noise.
+ */
+static std::vector<int16_t> loadFixture() {
+    std::string data;
+    std::string path = ::android::base::GetExecutableDirectory() + "/tests/data/haptics_burst.pcm";
+    if (!::android::base::ReadFileToString(path, &data)) return {};
+
+    std::vector<int16_t> samples(data.size() / sizeof(int16_t));
+    memcpy(samples.data(), data.data(), samples.size() * sizeof(int16_t));
+    return samples;
+}
+
+// The level after each buffer of the fixture
+static std::vector<float> followFixture() {
+    std::vector<int16_t> samples = loadFixture();
+    std::vector<float> levels;
+    EnvelopeFollower follower;
+
+    for (size_t i = 0; i + kBufferFrames * kChannels <= samples.size();
+         i += kBufferFrames * kChannels) {
+        levels.push_back(
+                follower.process(&samples[i], kBufferFrames * kChannels, kChannels, kSampleRate));
+    }
+
+    return levels;
+}
+
+TEST(HapticsEnvelopeTest, FollowsBurstInFixture) {
+    std::vector<float> levels = followFixture();
+    ASSERT_EQ(levels.size(), 36u);
+
+    // Noise alone stays far below the threshold
+    for (size_t i = 0; i < 4; i++) EXPECT_LT(levels[i], kHapticsThreshold / 4) << "buffer " << i;
+
+    // The attack catches up within the burst's first two buffers, never
+    // overshooting the peak plus noise
+    EXPECT_GT(levels[4], 0.5f);
+    EXPECT_GT(levels[5], 0.75f);
+    for (size_t i = 5; i < 12; i++) EXPECT_LE(levels[i], 0.81f) << "buffer " << i;
+
+    // Then it releases without ever rising again
+    for (size_t i = 12; i < levels.size(); i++) {
+        EXPECT_LT(levels[i], levels[i - 1]) << "buffer " << i;
+    }
+    EXPECT_LT(levels.back(), kHapticsThreshold);
+}
+
+TEST(HapticsEnvelopeTest, CrossesThresholdOncePerBurst) {
+    std::vector<float> levels = followFixture();
+    ASSERT_FALSE(levels.empty());
+
+    std::vector<size_t> crossings;
+    bool audible = false;
+    for (size_t i = 0; i < levels.size(); i++) {
+        if ((levels[i] >= kHapticsThreshold) != audible) {
+            audible = !audible;
+            crossings.push_back(i);
+        }
+    }
+
+    // On with the burst's first buffer, off about 170ms of release after its last
+    ASSERT_EQ(crossings.size(), 2u);
+    EXPECT_EQ(crossings[0], 4u);
+    EXPECT_GE(crossings[1], 27u);
+    EXPECT_LE(crossings[1], 30u);
+}
+
+TEST(HapticsEnvelopeTest, EmptyBufferKeepsLevel) {
+    EnvelopeFollower follower;
+    std::vector<int16_t> loud(kBufferFrames * kChannels, INT16_MAX);
+
+    float level = follower.process(loud.data(), loud.size(), kChannels, kSampleRate);
+    EXPECT_EQ(follower.process(loud.data(), 1, kChannels, kSampleRate), level);
+    EXPECT_EQ(follower.process(loud.data(), loud.size(), kChannels, 0), level);
+}
+
+TEST(HapticsEnvelopeTest, IntensityCoversVibratorRange) {
+    EXPECT_EQ(hapticsIntensity(0.0f), kHapticsIntensityMin);
+    EXPECT_EQ(hapticsIntensity(-1.0f), kHapticsIntensityMin);
+    EXPECT_EQ(hapticsIntensity(1.0f), kHapticsIntensityMax);
+    EXPECT_EQ(hapticsIntensity(2.0f), kHapticsIntensityMax);
+    EXPECT_LT(hapticsIntensity(kHapticsThreshold), hapticsIntensity(0.5f));
+}
+
+TEST(HapticsEnvelopeTest, SliceIsExtendedOnlyInItsSecondHalf) {
+    MotorSlice slice;
+    int64_t start = 1000 * kNsPerMs;
+
+    EXPECT_FALSE(slice.isRunning(start));
+    ASSERT_TRUE(slice.needsExtending(start));
+    slice.extend(start);
+
+    EXPECT_TRUE(slice.isRunning(start));
+    EXPECT_FALSE(slice.needsExtending(start + 10 * kNsPerMs));
+    EXPECT_FALSE(slice.needsExtending(start + 25 * kNsPerMs));
+    EXPECT_TRUE(slice.needsExtending(start + 26 * kNsPerMs));
+
+    // Runs out on its own if nobody extends it
+    EXPECT_TRUE(slice.isRunning(start + (MotorSlice::kSliceMs - 1) * kNsPerMs));
+    EXPECT_FALSE(slice.isRunning(start + MotorSlice::kSliceMs * kNsPerMs));
+
+    slice.extend(start + 30 * kNsPerMs);
+    EXPECT_TRUE(slice.isRunning(start + 60 * kNsPerMs));
+
+    slice.reset();
+    EXPECT_FALSE(slice.isRunning(start + 60 * kNsPerMs));
+    EXPECT_TRUE(slice.needsExtending(start + 60 * kNsPerMs));
+}
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
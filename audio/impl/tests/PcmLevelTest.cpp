@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "core/default/PcmLevel.h"
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace CPP_VERSION {
+namespace implementation {
+
+// Three interleaved channels, two of audio and one haptic, of a 440Hz tone with some noise
+static std::vector<int16_t> makeFixture(size_t frames, float amplitude) {
+    std::vector<int16_t> samples;
+    uint32_t seed = 1;
+
+    for (size_t i = 0; i < frames; i++) {
+        float tone = amplitude * std::sin(2.0f * M_PI * 440.0f * i / 48000.0f);
+        for (int channel = 0; channel < 3; channel++) {
+            seed = seed * 1103515245 + 12345;
+            int16_t noise = static_cast<int16_t>((seed >> 16) % 201) - 100;
+            samples.push_back(static_cast<int16_t>(std::lround(tone * INT16_MAX * 0.9f)) + noise);
+        }
+    }
+
+    return samples;
+}
+
+TEST(PcmLevelTest, MatchesScalarOnFixture) {
+    for (float amplitude : {0.0f, 0.01f, 0.5f, 1.0f}) {
+        std::vector<int16_t> samples = makeFixture(480, amplitude);
+        EXPECT_EQ(peakAbs(samples.data(), samples.size()),
+                  peakAbsScalar(samples.data(), samples.size()))
+                << "amplitude " << amplitude;
+    }
+}
+
+// Every length around the vector width, with the peak at every position
+TEST(PcmLevelTest, FindsPeakAnywhere) {
+    for (size_t count = 1; count <= 35; count++) {
+        for (size_t at = 0; at < count; at++) {
+            std::vector<int16_t> samples(count, -7);
+            samples[at] = at % 2 ? 1234 : -1234;
+
+            EXPECT_EQ(peakAbs(samples.data(), count), 1234) << count << " samples, peak at " << at;
+            EXPECT_EQ(peakAbsScalar(samples.data(), count), 1234);
+        }
+    }
+}
+
+TEST(PcmLevelTest, SaturatesMostNegativeSample) {
+    for (size_t count : {1, 8, 9, 16}) {
+        std::vector<int16_t> samples(count, 0);
+        samples[count - 1] = INT16_MIN;
+
+        EXPECT_EQ(peakAbs(samples.data(), count), INT16_MAX) << count << " samples";
+        EXPECT_EQ(peakAbsScalar(samples.data(), count), INT16_MAX) << count << " samples";
+    }
+}
+
+TEST(PcmLevelTest, EmptyBufferIsSilent) {
+    EXPECT_EQ(peakAbs(nullptr, 0), 0);
+}
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
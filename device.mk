@@ -145,8 +145,7 @@ PRODUCT_PACKAGES += \
     android.hardware.graphics.composer@2.4-service \
     android.hardware.graphics.mapper@3.0-impl-qti-display \
     android.hardware.graphics.mapper@4.0-impl-qti-display \
-    android.hardware.memtrack@1.0-impl \
-    android.hardware.memtrack@1.0-service \
+    android.hardware.memtrack-service.a70q \
     gralloc.sm6150 \
     hwcomposer.sm6150 \
     libdisplayconfig.qti \
@@ -154,7 +153,6 @@ PRODUCT_PACKAGES += \
     libtinyxml \
     libtinyxml2 \
     libvulkan \
-    memtrack.sm6150 \
     vendor.qti.hardware.display.allocator-service \
     vendor.qti.hardware.display.mapper@1.0.vendor \
     vendor.qti.hardware.display.mapper@1.1.vendor \
@@ -321,6 +319,10 @@ PRODUCT_PACKAGES += \
     vendor.qti.hardware.perf@2.1.vendor \
     vendor.qti.hardware.perf@2.2.vendor
 
+# Power stats
+PRODUCT_PACKAGES += \
+    android.hardware.power.stats-service.a70q
+
 # Protobuf
 PRODUCT_PACKAGES += \
     libprotobuf-cpp-lite-3.9.1-vendorcompat
@@ -409,7 +411,8 @@ PRODUCT_PACKAGES += \
 
 # Sensor Configuration
 PRODUCT_COPY_FILES += \
-    $(LOCAL_PATH)/sensors/hals.conf:$(TARGET_COPY_OUT_VENDOR)/etc/sensors/hals.conf
+    $(LOCAL_PATH)/sensors/hals.conf:$(TARGET_COPY_OUT_VENDOR)/etc/sensors/hals.conf \
+    $(LOCAL_PATH)/sensors/sysfs_sensors.conf:$(TARGET_COPY_OUT_VENDOR)/etc/sensors/sysfs_sensors.conf
 
 # Soong namespaces
 PRODUCT_SOONG_NAMESPACES += \
@@ -425,6 +428,7 @@ PRODUCT_BOOT_JARS += \
 
 # Thermal
 PRODUCT_PACKAGES += \
+    android.hardware.thermal-service.a70q \
     android.hardware.thermal@2.0.vendor
 
 # Touch
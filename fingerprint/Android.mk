@@ -20,6 +20,8 @@ include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES := \
     BiometricsFingerprint.cpp \
+    UdfpsIlluminator.cpp \
+    UnlockTracer.cpp \
     service.cpp
 
 LOCAL_SHARED_LIBRARIES := \
@@ -33,6 +35,8 @@ LOCAL_SHARED_LIBRARIES := \
     android.hardware.biometrics.fingerprint@2.2 \
     android.hardware.biometrics.fingerprint@2.3
 
+LOCAL_HEADER_LIBRARIES := libspscqueue_a70q_headers
+
 ifeq ($(TARGET_SEC_FP_CALL_NOTIFY_ON_CANCEL),true)
     LOCAL_CFLAGS += -DCALL_NOTIFY_ON_CANCEL
 endif
@@ -15,6 +15,7 @@
  */
 #define LOG_TAG "android.hardware.biometrics.fingerprint@2.3-service-samsung.a70q"
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 
 #include <hardware/hw_auth_token.h>
@@ -24,19 +25,19 @@
 #include "BiometricsFingerprint.h"
 #include <android-base/properties.h>
 #include <dlfcn.h>
+#include <errno.h>
 #include <fstream>
 #include <inttypes.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <sstream>
 #include <unistd.h>
 #include <cutils/properties.h>
 #include <string.h>
 
-#ifdef HAS_FINGERPRINT_GESTURES
 #include <fcntl.h>
-#endif
 
 #define TSP_CMD_PATH "/sys/class/sec/tsp/cmd"
-#define HBM_PATH "/sys/class/lcd/panel/mask_brightness"
-#define MASK_BRIGHTNESS_PATH "/sys/class/lcd/panel/actual_mask_brightness"
 
 namespace android {
 namespace hardware {
@@ -47,7 +48,48 @@ namespace implementation {
 
 using RequestStatus = android::hardware::biometrics::fingerprint::V2_1::RequestStatus;
 
+// Backoff of waitForSensor() while the library does not push status updates
+static constexpr auto kSensorPollMin = 250us;
+static constexpr auto kSensorPollMax = 20ms;
+// Only a safety net once the library is known to push them
+static constexpr auto kSensorPollPushed = 100ms;
+// How long enroll() waits for the sensor before calibrating it
+static constexpr auto kSensorReadyTimeout = 1s;
+
 BiometricsFingerprint* BiometricsFingerprint::sInstance = nullptr;
+// Set on the thread running deliver(), which the library may call notify() back on
+thread_local bool BiometricsFingerprint::sDelivering = false;
+
+static int64_t now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+}
+
+#ifdef CALL_NOTIFY_ON_CANCEL
+static fingerprint_msg_t canceledMessage() {
+    fingerprint_msg_t msg{};
+    msg.type = FINGERPRINT_ERROR;
+    msg.data.error = FINGERPRINT_ERROR_CANCELED;
+    return msg;
+}
+#endif
+
+static void updateMax(std::atomic<int64_t>* max, int64_t value) {
+    int64_t current = max->load(std::memory_order_relaxed);
+    while (value > current && !max->compare_exchange_weak(current, value)) {
+    }
+}
+
+void NotifyStats::reset() {
+    delivered = 0;
+    overflows = 0;
+    maxDepth = 0;
+    queuedSumNs = 0;
+    queuedMaxNs = 0;
+    deliverySumNs = 0;
+    deliveryMaxNs = 0;
+}
 
 template <typename T>
 static void set(const std::string& path, const T& value) {
@@ -55,20 +97,24 @@ static void set(const std::string& path, const T& value) {
     file << value;
 }
 
-template <typename T>
-static T get(const std::string& path, const T& def) {
-    std::ifstream file(path);
-    T result;
-    file >> result;
-    return file.fail() ? def : result;
-}
-
-BiometricsFingerprint::BiometricsFingerprint() : mClientCallback(nullptr) {
+BiometricsFingerprint::BiometricsFingerprint()
+    : mNotifyEventFd(eventfd(0, EFD_CLOEXEC)), mClientCallback(nullptr) {
     sInstance = this;  // keep track of the most recent instance
+    if (!mNotifyEventFd.ok()) {
+        PLOG(ERROR) << "Failed to create the notify eventfd";
+    }
+    // Must be running before the library can call notify()
+    mDispatchThread = std::thread(&BiometricsFingerprint::dispatchLoop, this);
+
     if (!openHal()) {
         LOG(ERROR) << "Can't open HAL module";
     }
 
+    mUdfps = std::make_unique<UdfpsIlluminator>(&mTracer, [this]() {
+        request(SEM_REQUEST_TOUCH_EVENT, FINGERPRINT_REQUEST_SESSION_OPEN);
+        mTracer.mark(UnlockStage::CAPTURE_REQUESTED);
+    });
+
     set(TSP_CMD_PATH, "set_fod_rect,426,2015,654,2243");
 
     std::ifstream in("/sys/devices/virtual/fingerprint/fingerprint/position");
@@ -119,6 +165,13 @@ BiometricsFingerprint::~BiometricsFingerprint() {
     if (ss_fingerprint_close() != 0) {
         LOG(ERROR) << "Can't close HAL module";
     }
+
+    // Whatever the library still sent gets delivered before the worker goes
+    mDispatchExit = true;
+    eventfd_write(mNotifyEventFd.get(), 1);
+    mDispatchThread.join();
+
+    mUdfps.reset();
 }
 
 Return<bool> BiometricsFingerprint::isUdfps(uint32_t) {
@@ -126,23 +179,81 @@ Return<bool> BiometricsFingerprint::isUdfps(uint32_t) {
 }
 
 Return<void> BiometricsFingerprint::onFingerDown(uint32_t, uint32_t, float, float) {
+    mTracer.begin();
     property_set("vendor.finger.down", "1");
 
-    std::thread([this]() {
-        std::this_thread::sleep_for(std::chrono::milliseconds(35));
-        set(HBM_PATH, "331");
-    }).detach();
-
-    request(SEM_REQUEST_TOUCH_EVENT, FINGERPRINT_REQUEST_SESSION_OPEN);
+    // The capture is started once the panel has actually lit the mask
+    mUdfps->fingerDown();
 
     return Void();
 }
 
 Return<void> BiometricsFingerprint::onFingerUp() {
-    if (strcmp(get<std::string>(MASK_BRIGHTNESS_PATH, "0").c_str(), "0") != 0) {
+    if (mUdfps->isLit()) {
         request(SEM_REQUEST_TOUCH_EVENT, FINGERPRINT_REQUEST_RESUME);
+    }
+
+    // Also drops an illumination that is still pending
+    mUdfps->off();
 
-        set(HBM_PATH, "0");
+    return Void();
+}
+
+Return<void> BiometricsFingerprint::debug(const hidl_handle& fd,
+                                          const hidl_vec<hidl_string>& args) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        LOG(ERROR) << "Missing fd for writing";
+        return Void();
+    }
+
+    bool reset = false;
+    for (const auto& arg : args) {
+        if (arg == "reset") {
+            reset = true;
+        } else {
+            android::base::WriteStringToFd("Usage: lshal debug <fqname> [reset]\n", fd->data[0]);
+            return Void();
+        }
+    }
+
+    std::ostringstream stream;
+    mTracer.dump(stream);
+    stream << "UDFPS panel delay: " << mUdfps->calibratedDelayNs() / 1000 << "us" << std::endl;
+
+    SensorWaitStats waitStats;
+    {
+        std::lock_guard<std::mutex> lock(mSensorStatusMutex);
+        waitStats = mSensorWaitStats;
+    }
+    stream << "Sensor waits: " << waitStats.waits << ", ready " << waitStats.ready << ", errors "
+           << waitStats.errors << ", timeouts " << waitStats.timeouts << std::endl;
+    if (waitStats.ready > 0) {
+        stream << "Time to ready: last " << waitStats.readyLastNs / 1000 << "us, mean "
+               << waitStats.readySumNs / static_cast<int64_t>(waitStats.ready) / 1000
+               << "us, max " << waitStats.readyMaxNs / 1000 << "us" << std::endl;
+    }
+    stream << "Sensor status: polls " << waitStats.polls << ", pushes " << waitStats.pushes
+           << std::endl;
+
+    uint64_t delivered = mNotifyStats.delivered;
+    stream << "Notify queue: depth " << mNotifyQueue.size() << "/" << kNotifyQueueSize << ", max "
+           << mNotifyStats.maxDepth << ", overflows " << mNotifyStats.overflows << std::endl;
+    stream << "Notify delivered: " << delivered << std::endl;
+    if (delivered > 0) {
+        stream << "Notify latency: queued mean "
+               << mNotifyStats.queuedSumNs / static_cast<int64_t>(delivered) / 1000 << "us, max "
+               << mNotifyStats.queuedMaxNs / 1000 << "us; delivered mean "
+               << mNotifyStats.deliverySumNs / static_cast<int64_t>(delivered) / 1000
+               << "us, max " << mNotifyStats.deliveryMaxNs / 1000 << "us" << std::endl;
+    }
+    android::base::WriteStringToFd(stream.str(), fd->data[0]);
+
+    if (reset) {
+        mTracer.reset();
+        mNotifyStats.reset();
+
+        std::lock_guard<std::mutex> lock(mSensorStatusMutex);
+        mSensorWaitStats = SensorWaitStats();
     }
 
     return Void();
@@ -259,6 +370,10 @@ Return<RequestStatus> BiometricsFingerprint::enroll(const hidl_array<uint8_t, 69
     const hw_auth_token_t* authToken = reinterpret_cast<const hw_auth_token_t*>(hat.data());
 
 #ifdef REQUEST_FORCE_CALIBRATE
+    // Calibration requested while the sensor is still busy gets lost
+    if (waitForSensor(kSensorReadyTimeout) != 0) {
+        LOG(WARNING) << "Sensor not ready, calibrating anyway";
+    }
     request(SEM_REQUEST_FORCE_CBGE, 1);
 #endif
 
@@ -278,10 +393,13 @@ Return<RequestStatus> BiometricsFingerprint::cancel() {
 
 #ifdef CALL_NOTIFY_ON_CANCEL
     if (ret == 0) {
-        fingerprint_msg_t msg{};
-        msg.type = FINGERPRINT_ERROR;
-        msg.data.error = FINGERPRINT_ERROR_CANCELED;
-        notify(&msg);
+        std::lock_guard<std::mutex> lock(mNotifyMutex);
+        if (mDispatching) {
+            mCancelPending = true;
+            eventfd_write(mNotifyEventFd.get(), 1);
+        } else {
+            dispatch(canceledMessage());
+        }
     }
 #endif
 
@@ -377,8 +495,125 @@ bool BiometricsFingerprint::openHal() {
 void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
     BiometricsFingerprint* thisPtr =
         static_cast<BiometricsFingerprint*>(BiometricsFingerprint::getInstance());
-    std::lock_guard<std::mutex> lock(thisPtr->mClientCallbackMutex);
-    if (thisPtr == nullptr || thisPtr->mClientCallback == nullptr) {
+
+    // The library called back from inside a call deliver() made, e.g. ss_fingerprint_cancel()
+    if (sDelivering) {
+        thisPtr->mReentrantMessages.push_back(*msg);
+        return;
+    }
+
+    // The queue takes a single producer, but the library may call from several threads
+    std::lock_guard<std::mutex> lock(thisPtr->mNotifyMutex);
+
+    if (!thisPtr->mDispatching) {
+        // Nobody else would deliver it, do so on the library's thread instead
+        thisPtr->dispatchQueued();
+        thisPtr->dispatch(*msg);
+        return;
+    }
+
+    QueuedMessage item{*msg, now()};
+    size_t depth;
+    {
+        std::lock_guard<std::mutex> overflowLock(thisPtr->mOverflowMutex);
+        auto& overflow = thisPtr->mOverflowMessages;
+
+        // Never drop a result nor hold up the library, set it aside when full
+        if (!overflow.empty() || !thisPtr->mNotifyQueue.push(item)) {
+            overflow.push_back(item);
+            if (thisPtr->mNotifyStats.overflows++ == 0) {
+                LOG(WARNING) << "Notify queue is full, the client callback is slow";
+            }
+        }
+        depth = thisPtr->mNotifyQueue.size() + overflow.size();
+    }
+
+    if (depth > thisPtr->mNotifyStats.maxDepth) {
+        thisPtr->mNotifyStats.maxDepth = depth;
+    }
+    eventfd_write(thisPtr->mNotifyEventFd.get(), 1);
+}
+
+void BiometricsFingerprint::dispatchLoop() {
+    while (!mDispatchExit) {
+        eventfd_t count;
+        if (eventfd_read(mNotifyEventFd.get(), &count) != 0) {
+            if (errno == EINTR) continue;
+            PLOG(ERROR) << "Failed to wait for notify messages";
+            break;
+        }
+
+#ifdef CALL_NOTIFY_ON_CANCEL
+        // Taken first, so that whatever the library sent before it goes out first
+        bool cancelPending = mCancelPending.exchange(false);
+#endif
+
+        dispatchQueued();
+
+#ifdef CALL_NOTIFY_ON_CANCEL
+        if (cancelPending) {
+            dispatch(canceledMessage());
+        }
+#endif
+    }
+
+    // From here on notify() delivers on the library's thread
+    mDispatching = false;
+    std::lock_guard<std::mutex> lock(mNotifyMutex);
+    dispatchQueued();
+#ifdef CALL_NOTIFY_ON_CANCEL
+    if (mCancelPending.exchange(false)) {
+        dispatch(canceledMessage());
+    }
+#endif
+}
+
+void BiometricsFingerprint::dispatchQueued() {
+    auto dispatchItem = [this](const QueuedMessage& item) {
+        int64_t dequeuedNs = now();
+        dispatch(item.msg);
+        int64_t deliveredNs = now();
+
+        mNotifyStats.delivered++;
+        mNotifyStats.queuedSumNs += dequeuedNs - item.enqueuedNs;
+        updateMax(&mNotifyStats.queuedMaxNs, dequeuedNs - item.enqueuedNs);
+        mNotifyStats.deliverySumNs += deliveredNs - item.enqueuedNs;
+        updateMax(&mNotifyStats.deliveryMaxNs, deliveredNs - item.enqueuedNs);
+    };
+
+    std::deque<QueuedMessage> overflow;
+    for (;;) {
+        QueuedMessage item;
+        while (mNotifyQueue.pop(&item)) dispatchItem(item);
+
+        // Everything set aside is newer than what was queued before it, and older
+        // than whatever notify() queues once it is taken
+        {
+            std::lock_guard<std::mutex> lock(mOverflowMutex);
+            if (mOverflowMessages.empty()) return;
+            overflow.swap(mOverflowMessages);
+        }
+        for (const QueuedMessage& overflowed : overflow) dispatchItem(overflowed);
+        overflow.clear();
+    }
+}
+
+void BiometricsFingerprint::dispatch(fingerprint_msg_t msg) {
+    sDelivering = true;
+    deliver(&msg);
+
+    // Whatever the library sent while deliver() was calling into it comes right after
+    while (!mReentrantMessages.empty()) {
+        msg = mReentrantMessages.front();
+        mReentrantMessages.pop_front();
+        deliver(&msg);
+    }
+    sDelivering = false;
+}
+
+void BiometricsFingerprint::deliver(fingerprint_msg_t* msg) {
+    std::lock_guard<std::mutex> lock(mClientCallbackMutex);
+    if (mClientCallback == nullptr) {
         LOG(ERROR) << "Receiving callbacks before the client callback is registered.";
         return;
     }
@@ -388,39 +623,40 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
             int32_t vendorCode = 0;
             FingerprintError result = VendorErrorFilter(msg->data.error, &vendorCode);
             LOG(DEBUG) << "onError(" << static_cast<int>(result) << ")";
-            if (!thisPtr->mClientCallback->onError(devId, result, vendorCode).isOk()) {
+            mTracer.finish(UnlockOutcome::ERROR);
+            if (!mClientCallback->onError(devId, result, vendorCode).isOk()) {
                 LOG(ERROR) << "failed to invoke fingerprint onError callback";
             }
-            getInstance()->onFingerUp();
+            onFingerUp();
         } break;
         case FINGERPRINT_ACQUIRED: {
             if (msg->data.acquired.acquired_info > SEM_FINGERPRINT_EVENT_BASE) {
-                thisPtr->handleEvent(msg->data.acquired.acquired_info);
+                handleEvent(msg->data.acquired.acquired_info);
                 return;
             }
             int32_t vendorCode = 0;
             FingerprintAcquiredInfo result =
                 VendorAcquiredFilter(msg->data.acquired.acquired_info, &vendorCode);
             LOG(DEBUG) << "onAcquired(" << static_cast<int>(result) << ")";
-            if (!thisPtr->mClientCallback->onAcquired(devId, result, vendorCode).isOk()) {
+            mTracer.mark(UnlockStage::ACQUIRED);
+            if (!mClientCallback->onAcquired(devId, result, vendorCode).isOk()) {
                 LOG(ERROR) << "failed to invoke fingerprint onAcquired callback";
             }
         } break;
         case FINGERPRINT_TEMPLATE_ENROLLING:
 #ifdef USES_PERCENTAGE_SAMPLES
-            const_cast<fingerprint_msg_t*>(msg)->data.enroll.samples_remaining =
-                100 - msg->data.enroll.samples_remaining;
+            msg->data.enroll.samples_remaining = 100 - msg->data.enroll.samples_remaining;
 #endif
             if(msg->data.enroll.samples_remaining == 0) {
-                set(HBM_PATH, "0");
+                mUdfps->off();
 #ifdef CALL_CANCEL_ON_ENROLL_COMPLETION
-                thisPtr->ss_fingerprint_cancel();
+                ss_fingerprint_cancel();
 #endif
             }
             LOG(DEBUG) << "onEnrollResult(fid=" << msg->data.enroll.finger.fid
                        << ", gid=" << msg->data.enroll.finger.gid
                        << ", rem=" << msg->data.enroll.samples_remaining << ")";
-            if (!thisPtr->mClientCallback
+            if (!mClientCallback
                     ->onEnrollResult(devId, msg->data.enroll.finger.fid,
                                      msg->data.enroll.finger.gid, msg->data.enroll.samples_remaining)
                     .isOk()) {
@@ -431,7 +667,7 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
             LOG(DEBUG) << "onRemove(fid=" << msg->data.removed.finger.fid
                        << ", gid=" << msg->data.removed.finger.gid
                        << ", rem=" << msg->data.removed.remaining_templates << ")";
-            if (!thisPtr->mClientCallback
+            if (!mClientCallback
                      ->onRemoved(devId, msg->data.removed.finger.fid, msg->data.removed.finger.gid,
                                  msg->data.removed.remaining_templates)
                      .isOk()) {
@@ -441,12 +677,15 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
         case FINGERPRINT_AUTHENTICATED:
             LOG(DEBUG) << "onAuthenticated(fid=" << msg->data.authenticated.finger.fid
                        << ", gid=" << msg->data.authenticated.finger.gid << ")";
+            mTracer.finish(msg->data.authenticated.finger.fid != 0
+                                            ? UnlockOutcome::MATCHED
+                                            : UnlockOutcome::REJECTED);
             if (msg->data.authenticated.finger.fid != 0) {
                 const uint8_t* hat = reinterpret_cast<const uint8_t*>(&msg->data.authenticated.hat);
                 const hidl_vec<uint8_t> token(
                     std::vector<uint8_t>(hat, hat + sizeof(msg->data.authenticated.hat)));
-                set(HBM_PATH, "0");
-                if (!thisPtr->mClientCallback
+                mUdfps->off();
+                if (!mClientCallback
                          ->onAuthenticated(devId, msg->data.authenticated.finger.fid,
                                            msg->data.authenticated.finger.gid, token)
                          .isOk()) {
@@ -454,7 +693,7 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
                 }
             } else {
                 // Not a recognized fingerprint
-                if (!thisPtr->mClientCallback
+                if (!mClientCallback
                          ->onAuthenticated(devId, msg->data.authenticated.finger.fid,
                                            msg->data.authenticated.finger.gid, hidl_vec<uint8_t>())
                          .isOk()) {
@@ -466,7 +705,7 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
             LOG(DEBUG) << "onEnumerate(fid=" << msg->data.enumerated.finger.fid
                        << ", gid=" << msg->data.enumerated.finger.gid
                        << ", rem=" << msg->data.enumerated.remaining_templates << ")";
-            if (!thisPtr->mClientCallback
+            if (!mClientCallback
                      ->onEnumerate(devId, msg->data.enumerated.finger.fid,
                                    msg->data.enumerated.finger.gid,
                                    msg->data.enumerated.remaining_templates)
@@ -479,6 +718,12 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
 
 void BiometricsFingerprint::handleEvent(int eventCode) {
     switch (eventCode) {
+        case SEM_SENSOR_STATUS_OK:
+        case SEM_SENSOR_STATUS_WORKING:
+        case SEM_SENSOR_STATUS_ERROR:
+        case SEM_SENSOR_STATUS_CALIBRATION_ERROR:
+            onSensorStatus(eventCode);
+            break;
 #ifdef HAS_FINGERPRINT_GESTURES
         case SEM_FINGERPRINT_EVENT_GESTURE_SWIPE_DOWN:
         case SEM_FINGERPRINT_EVENT_GESTURE_SWIPE_UP:
@@ -533,22 +778,88 @@ int BiometricsFingerprint::request(int cmd, int param) {
     return result;
 }
 
-int BiometricsFingerprint::waitForSensor(std::chrono::milliseconds pollWait,
-                                         std::chrono::milliseconds timeOut) {
-    int sensorStatus = SEM_SENSOR_STATUS_WORKING;
-    std::chrono::milliseconds timeWaited = 0ms;
-    while (sensorStatus != SEM_SENSOR_STATUS_OK) {
-        if (sensorStatus == SEM_SENSOR_STATUS_CALIBRATION_ERROR
-                || sensorStatus == SEM_SENSOR_STATUS_ERROR){
-            return -1;
+int BiometricsFingerprint::querySensorStatus() {
+    int status = ss_fingerprint_request(FINGERPRINT_REQUEST_GET_SENSOR_STATUS, nullptr, 0, nullptr,
+                                        0, 0);
+    LOG(VERBOSE) << "querySensorStatus() = " << status;
+    return status;
+}
+
+void BiometricsFingerprint::onSensorStatus(int status) {
+    {
+        std::lock_guard<std::mutex> lock(mSensorStatusMutex);
+        mSensorStatus = status;
+        mSensorWaitStats.pushes++;
+    }
+    mSensorStatusCv.notify_all();
+}
+
+int BiometricsFingerprint::waitForSensor(std::chrono::milliseconds timeOut) {
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + timeOut;
+
+    std::unique_lock<std::mutex> lock(mSensorStatusMutex);
+    mSensorWaitStats.waits++;
+
+    std::chrono::microseconds pollWait = mSensorWaitStats.pushes > 0 ? kSensorPollPushed
+                                                                     : kSensorPollMin;
+    int sensorStatus;
+    for (;;) {
+        uint64_t pushes = mSensorWaitStats.pushes;
+
+        lock.unlock();
+        sensorStatus = querySensorStatus();
+        lock.lock();
+        mSensorWaitStats.polls++;
+        // Whatever was pushed in the meantime is newer
+        if (mSensorWaitStats.pushes != pushes) {
+            sensorStatus = mSensorStatus;
+        }
+
+        if (sensorStatus != SEM_SENSOR_STATUS_WORKING &&
+            sensorStatus != SEM_SENSOR_STATUS_CALIBRATION_ERROR &&
+            sensorStatus != SEM_SENSOR_STATUS_ERROR && sensorStatus != SEM_SENSOR_STATUS_OK) {
+            // Anything else is a failed request, keep trying
+            sensorStatus = SEM_SENSOR_STATUS_WORKING;
+        }
+        if (sensorStatus != SEM_SENSOR_STATUS_WORKING) break;
+
+        // Sleeps until the next poll, unless the library pushes a status first
+        pushes = mSensorWaitStats.pushes;
+        auto wakeup = std::min<std::chrono::steady_clock::time_point>(
+                std::chrono::steady_clock::now() + pollWait, deadline);
+        if (mSensorStatusCv.wait_until(lock, wakeup, [&] {
+                return mSensorWaitStats.pushes != pushes &&
+                       mSensorStatus != SEM_SENSOR_STATUS_WORKING;
+            })) {
+            sensorStatus = mSensorStatus;
+            break;
         }
-        if (timeWaited >= timeOut) {
+
+        if (std::chrono::steady_clock::now() >= deadline) {
+            mSensorWaitStats.timeouts++;
             return -2;
         }
-        sensorStatus = request(FINGERPRINT_REQUEST_GET_SENSOR_STATUS, 0);
-        std::this_thread::sleep_for(pollWait);
-        timeWaited += pollWait;
+
+        if (mSensorWaitStats.pushes > 0) {
+            pollWait = kSensorPollPushed;
+        } else {
+            pollWait = std::min<std::chrono::microseconds>(pollWait * 2, kSensorPollMax);
+        }
     }
+
+    if (sensorStatus != SEM_SENSOR_STATUS_OK) {
+        mSensorWaitStats.errors++;
+        return -1;
+    }
+
+    int64_t readyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+    mSensorWaitStats.ready++;
+    mSensorWaitStats.readyLastNs = readyNs;
+    mSensorWaitStats.readyMaxNs = std::max(mSensorWaitStats.readyMaxNs, readyNs);
+    mSensorWaitStats.readySumNs += readyNs;
     return 0;
 }
 
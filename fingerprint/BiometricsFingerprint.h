@@ -16,7 +16,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <thread>
 
 #ifdef HAS_FINGERPRINT_GESTURES
@@ -29,7 +34,11 @@
 #include <hidl/Status.h>
 #include <android/hardware/biometrics/fingerprint/2.3/IBiometricsFingerprint.h>
 #include <android/hardware/biometrics/fingerprint/2.1/types.h>
+#include <android-base/unique_fd.h>
+#include <SpscQueue.h>
 
+#include "UdfpsIlluminator.h"
+#include "UnlockTracer.h"
 #include "VendorConstants.h"
 
 namespace android {
@@ -42,6 +51,7 @@ namespace implementation {
 using namespace std::chrono_literals;
 
 using ::android::sp;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
@@ -52,6 +62,36 @@ using ::android::hardware::biometrics::fingerprint::V2_1::FingerprintAcquiredInf
 using ::android::hardware::biometrics::fingerprint::V2_1::FingerprintError;
 using ::android::hardware::biometrics::fingerprint::V2_1::RequestStatus;
 
+// How long waitForSensor() took until the sensor reported ready
+struct SensorWaitStats {
+    uint64_t waits{0};
+    uint64_t ready{0};
+    uint64_t errors{0};
+    uint64_t timeouts{0};
+    // Status requests sent to the TA, and status updates the library pushed
+    uint64_t polls{0};
+    uint64_t pushes{0};
+    int64_t readyLastNs{0};
+    int64_t readyMaxNs{0};
+    int64_t readySumNs{0};
+};
+
+// Vendor notify() messages on their way to the client callback
+struct NotifyStats {
+    std::atomic<uint64_t> delivered{0};
+    // Messages notify() found the queue full for and set aside instead
+    std::atomic<uint64_t> overflows{0};
+    std::atomic<size_t> maxDepth{0};
+    // From notify() to the dispatcher picking the message up
+    std::atomic<int64_t> queuedSumNs{0};
+    std::atomic<int64_t> queuedMaxNs{0};
+    // From notify() to the client callback returning
+    std::atomic<int64_t> deliverySumNs{0};
+    std::atomic<int64_t> deliveryMaxNs{0};
+
+    void reset();
+};
+
 struct BiometricsFingerprint : public IBiometricsFingerprint {
     BiometricsFingerprint();
     ~BiometricsFingerprint();
@@ -76,21 +116,78 @@ struct BiometricsFingerprint : public IBiometricsFingerprint {
     Return<void> onFingerDown(uint32_t x, uint32_t y, float minor, float major) override;
     Return<void> onFingerUp() override;
 
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& args) override;
+
   private:
     bool openHal();
     int request(int cmd, int param);
-    int waitForSensor(std::chrono::milliseconds pollWait, std::chrono::milliseconds timeOut);
+    int waitForSensor(std::chrono::milliseconds timeOut);
+    // Asks the TA for the sensor status, without request()'s logging
+    int querySensorStatus();
+    void onSensorStatus(int status);
     static void notify(
         const fingerprint_msg_t* msg); /* Static callback for legacy HAL implementation */
+    void dispatchLoop();
+    // Delivers everything queued and set aside, the caller must be the only consumer
+    void dispatchQueued();
+    // Delivers msg, then whatever the library sent back while it was delivered
+    void dispatch(fingerprint_msg_t msg);
+    // Runs on the dispatcher in the order the library sent the messages, or on the
+    // library's thread once the dispatcher has stopped
+    void deliver(fingerprint_msg_t* msg);
     void handleEvent(int eventCode);
     static Return<RequestStatus> ErrorFilter(int32_t error);
     static FingerprintError VendorErrorFilter(int32_t error, int32_t* vendorCode);
     static FingerprintAcquiredInfo VendorAcquiredFilter(int32_t error, int32_t* vendorCode);
     static BiometricsFingerprint* sInstance;
+    static thread_local bool sDelivering;
+
+    struct QueuedMessage {
+        fingerprint_msg_t msg;
+        int64_t enqueuedNs;
+    };
+    static constexpr size_t kNotifyQueueSize = 64;
+
+    /*
+     * notify() only copies the message into the queue and kicks the eventfd, so
+     * the library's callback thread never waits on binder or sysfs. The client
+     * callbacks and the state changes that go with them run on the dispatcher.
+     */
+    SpscQueue<QueuedMessage, kNotifyQueueSize> mNotifyQueue;
+    ::android::base::unique_fd mNotifyEventFd;
+    std::atomic<bool> mDispatchExit{false};
+    // Serializes the library's threads as the queue's one producer
+    std::mutex mNotifyMutex;
+    // Cleared once the dispatcher has stopped for good, whoever holds mNotifyMutex then
+    // is the queue's consumer
+    std::atomic<bool> mDispatching{true};
+    // Messages that did not fit into the queue, delivered after it. While there are
+    // any, later messages go here too to keep their order.
+    std::mutex mOverflowMutex;
+    std::deque<QueuedMessage> mOverflowMessages;
+    // Only touched by the thread in dispatch()
+    std::deque<fingerprint_msg_t> mReentrantMessages;
+#ifdef CALL_NOTIFY_ON_CANCEL
+    // cancel() must not push into the queue, it is not the library's thread
+    std::atomic<bool> mCancelPending{false};
+#endif
+    NotifyStats mNotifyStats;
+    std::thread mDispatchThread;
 
     std::mutex mClientCallbackMutex;
     sp<IBiometricsFingerprintClientCallback> mClientCallback;
     bool mIsUdfps;
+    UnlockTracer mTracer;
+
+    /*
+     * The sensor status the library pushed last. A push wakes waitForSensor(),
+     * which otherwise polls the TA at growing intervals.
+     */
+    std::mutex mSensorStatusMutex;
+    std::condition_variable mSensorStatusCv;
+    int mSensorStatus{SEM_SENSOR_STATUS_WORKING};
+    SensorWaitStats mSensorWaitStats;
+    std::unique_ptr<UdfpsIlluminator> mUdfps;
 #ifdef HAS_FINGERPRINT_GESTURES
     int uinputFd;
 #endif
@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2024 The LineageOS Project
+
+#define LOG_TAG "android.hardware.biometrics.fingerprint@2.3-service-samsung.a70q"
+
+#include "UdfpsIlluminator.h"
+
+#include <android-base/logging.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#define HBM_PATH "/sys/class/lcd/panel/mask_brightness"
+#define MASK_BRIGHTNESS_PATH "/sys/class/lcd/panel/actual_mask_brightness"
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+
+using namespace std::chrono_literals;
+
+static constexpr char kMaskOn[] = "331";
+static constexpr char kMaskOff[] = "0";
+
+static constexpr int kWorkerPriority = 2;
+
+// What the panel used to be given unconditionally, until it is measured
+static constexpr int64_t kInitialDelayNs = 35'000'000;
+static constexpr int64_t kTimeoutNs = 100'000'000;
+static constexpr auto kPollInterval = 500us;
+
+static int64_t now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+}
+
+UdfpsIlluminator::UdfpsIlluminator(UnlockTracer* tracer, Callback onIlluminated)
+    : mMaskFd(open(HBM_PATH, O_WRONLY | O_CLOEXEC)),
+      mActualMaskFd(open(MASK_BRIGHTNESS_PATH, O_RDONLY | O_CLOEXEC)),
+      mTracer(tracer),
+      mOnIlluminated(std::move(onIlluminated)),
+      mCalibratedDelayNs(kInitialDelayNs) {
+    if (!mMaskFd.ok() || !mActualMaskFd.ok()) {
+        PLOG(ERROR) << "Failed to open panel mask nodes";
+    }
+
+    mThread = std::thread(&UdfpsIlluminator::run, this);
+}
+
+UdfpsIlluminator::~UdfpsIlluminator() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExit = true;
+    }
+    mCv.notify_all();
+    mThread.join();
+}
+
+void UdfpsIlluminator::fingerDown() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mGeneration++;
+        mPending = true;
+    }
+    mCv.notify_all();
+}
+
+void UdfpsIlluminator::off() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mGeneration++;
+    mPending = false;
+
+    pwrite(mMaskFd.get(), kMaskOff, sizeof(kMaskOff) - 1, 0);
+}
+
+bool UdfpsIlluminator::isLit() {
+    char buf[16];
+    ssize_t n = pread(mActualMaskFd.get(), buf, sizeof(buf), 0);
+    return n > 0 && buf[0] != '0';
+}
+
+void UdfpsIlluminator::run() {
+    struct sched_param param = {.sched_priority = kWorkerPriority};
+    if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &param) != 0) {
+        PLOG(WARNING) << "Failed to make the UDFPS worker real-time";
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;) {
+        mCv.wait(lock, [this] { return mExit || mPending; });
+        if (mExit) return;
+
+        mPending = false;
+        uint64_t generation = mGeneration;
+
+        lock.unlock();
+        illuminate(generation);
+        lock.lock();
+    }
+}
+
+void UdfpsIlluminator::illuminate(uint64_t generation) {
+    int64_t start = now();
+    {
+        // off() writes kMaskOff under the same lock, so it always lands after this
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mGeneration != generation) return;
+        pwrite(mMaskFd.get(), kMaskOn, sizeof(kMaskOn) - 1, 0);
+    }
+    mTracer->mark(UnlockStage::MASK_WRITTEN);
+
+    // Sleep through most of the usual delay, then poll for the rest
+    std::this_thread::sleep_for(std::chrono::nanoseconds(mCalibratedDelayNs * 3 / 4));
+
+    bool lit;
+    while (!(lit = isLit()) && now() - start < kTimeoutNs) {
+        if (mGeneration != generation) return;
+        std::this_thread::sleep_for(kPollInterval);
+    }
+
+    if (mGeneration != generation) return;
+
+    if (lit) {
+        mTracer->mark(UnlockStage::MASK_LIT);
+
+        // Moving average over the last few presses
+        int64_t delay = now() - start;
+        mCalibratedDelayNs = (mCalibratedDelayNs * 7 + delay) / 8;
+    } else {
+        LOG(WARNING) << "Panel did not confirm the mask, capturing anyway";
+    }
+
+    mOnIlluminated();
+}
+
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2024 The LineageOS Project
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "UnlockTracer.h"
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+
+/*
+ * Lights up the in-display sensor area. A real-time worker is created up front
+ * and the panel nodes stay open, so finger down only has to wake the worker.
+ *
+ * The worker writes mask_brightness and reads actual_mask_brightness back
+ * until the panel has applied it, then calls onIlluminated, which is where the
+ * capture is started. How long the panel takes is learned as it goes, so the
+ * worker sleeps through most of the wait and only polls near the end.
+ */
+class UdfpsIlluminator {
+  public:
+    using Callback = std::function<void()>;
+
+    // Marks the mask stages of the current attempt on tracer
+    UdfpsIlluminator(UnlockTracer* tracer, Callback onIlluminated);
+    ~UdfpsIlluminator();
+
+    void fingerDown();
+    // Cancels a pending illumination and turns the mask off
+    void off();
+    // Whether the panel is currently showing the mask
+    bool isLit();
+
+    int64_t calibratedDelayNs() const { return mCalibratedDelayNs; }
+
+  private:
+    void run();
+    void illuminate(uint64_t generation);
+
+    ::android::base::unique_fd mMaskFd;
+    ::android::base::unique_fd mActualMaskFd;
+    UnlockTracer* mTracer;
+    Callback mOnIlluminated;
+
+    // Bumped by every finger down and off(), a stale worker pass gives up. The
+    // mask is only written under mMutex, after checking it has not changed.
+    std::atomic<uint64_t> mGeneration{0};
+    std::atomic<int64_t> mCalibratedDelayNs;
+
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    bool mPending{false};
+    bool mExit{false};
+    std::thread mThread;
+};
+
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
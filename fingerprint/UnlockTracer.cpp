@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2024 The LineageOS Project
+
+#define ATRACE_TAG ATRACE_TAG_HAL
+
+#include "UnlockTracer.h"
+
+#include <cutils/trace.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+
+static constexpr const char* kStageNames[] = {
+        "finger_down", "mask_written", "mask_lit", "capture_requested", "acquired", "authenticated",
+};
+static_assert(std::size(kStageNames) == static_cast<size_t>(UnlockStage::COUNT));
+
+// Slice names, each one runs from its stage to the next one reached
+static constexpr const char* kSliceNames[] = {
+        "fp_unlock:finger_down",       "fp_unlock:mask_written", "fp_unlock:mask_lit",
+        "fp_unlock:capture_requested", "fp_unlock:acquired",     "fp_unlock:authenticated",
+};
+static_assert(std::size(kSliceNames) == static_cast<size_t>(UnlockStage::COUNT));
+
+static constexpr const char* kOutcomeNames[] = {"matched", "rejected", "error", "abandoned"};
+
+static constexpr char kAttemptSliceName[] = "fp_unlock";
+
+static int64_t now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+}
+
+static double toMs(int64_t ns) {
+    return ns / 1e6;
+}
+
+void UnlockTracer::begin() {
+    int64_t timestampNs = now();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mActive) {
+        finishLocked(UnlockOutcome::ABANDONED);
+    }
+
+    mCurrent = Attempt();
+    mCurrent.cookie = mNextCookie++;
+    mActive = true;
+
+    ATRACE_ASYNC_BEGIN(kAttemptSliceName, mCurrent.cookie);
+    mCurrent.timestampsNs[0] = timestampNs;
+    mLastStage = 0;
+    ATRACE_ASYNC_BEGIN(kSliceNames[0], mCurrent.cookie);
+}
+
+void UnlockTracer::mark(UnlockStage stage) {
+    int64_t timestampNs = now();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    markLocked(stage, timestampNs);
+}
+
+void UnlockTracer::finish(UnlockOutcome outcome) {
+    int64_t timestampNs = now();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (outcome == UnlockOutcome::MATCHED || outcome == UnlockOutcome::REJECTED) {
+        markLocked(UnlockStage::AUTHENTICATED, timestampNs);
+    }
+    finishLocked(outcome);
+}
+
+void UnlockTracer::markLocked(UnlockStage stage, int64_t timestampNs) {
+    size_t index = static_cast<size_t>(stage);
+    if (!mActive || mCurrent.timestampsNs[index] != 0) return;
+
+    mCurrent.timestampsNs[index] = timestampNs;
+
+    ATRACE_ASYNC_END(kSliceNames[mLastStage], mCurrent.cookie);
+    mLastStage = index;
+    ATRACE_ASYNC_BEGIN(kSliceNames[index], mCurrent.cookie);
+}
+
+void UnlockTracer::finishLocked(UnlockOutcome outcome) {
+    if (!mActive) return;
+
+    ATRACE_ASYNC_END(kSliceNames[mLastStage], mCurrent.cookie);
+    ATRACE_ASYNC_END(kAttemptSliceName, mCurrent.cookie);
+
+    mCurrent.outcome = outcome;
+    mAttempts[mNextAttempt] = mCurrent;
+    mNextAttempt = (mNextAttempt + 1) % kNumAttempts;
+    mNumAttempts = std::min(mNumAttempts + 1, kNumAttempts);
+    mActive = false;
+}
+
+void UnlockTracer::reset() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mNumAttempts = 0;
+    mNextAttempt = 0;
+}
+
+void UnlockTracer::dump(std::ostream& out) {
+    std::vector<Attempt> attempts;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // Oldest first
+        for (size_t i = 0; i < mNumAttempts; i++) {
+            attempts.push_back(mAttempts[(mNextAttempt + kNumAttempts - mNumAttempts + i) %
+                                         kNumAttempts]);
+        }
+    }
+
+    out << "Unlock attempts: " << attempts.size() << std::endl;
+    if (attempts.empty()) return;
+
+    /*
+     * A stage's latency is measured from the latest earlier stage the attempt
+     * reached, so a skipped stage does not show up as a gap of its own.
+     */
+    std::array<std::vector<int64_t>, kNumStages> deltas;
+    std::vector<int64_t> totals;
+    for (const auto& attempt : attempts) {
+        int64_t previousNs = attempt.timestampsNs[0];
+        for (size_t stage = 1; stage < kNumStages; stage++) {
+            int64_t timestampNs = attempt.timestampsNs[stage];
+            if (timestampNs == 0) continue;
+            deltas[stage].push_back(timestampNs - previousNs);
+            previousNs = timestampNs;
+        }
+        if (attempt.outcome == UnlockOutcome::MATCHED) {
+            totals.push_back(previousNs - attempt.timestampsNs[0]);
+        }
+    }
+
+    auto printPercentiles = [&out](const char* name, std::vector<int64_t>& values) {
+        out << "  " << std::left << std::setw(20) << name << std::right;
+        if (values.empty()) {
+            out << "-" << std::endl;
+            return;
+        }
+        std::sort(values.begin(), values.end());
+        auto percentile = [&values](size_t p) { return values[(values.size() - 1) * p / 100]; };
+        out << std::fixed << std::setprecision(2) << "n=" << values.size()
+            << " p50=" << toMs(percentile(50)) << "ms p90=" << toMs(percentile(90))
+            << "ms max=" << toMs(values.back()) << "ms" << std::endl;
+    };
+
+    out << "Stage latency from the previous stage:" << std::endl;
+    for (size_t stage = 1; stage < kNumStages; stage++) {
+        printPercentiles(kStageNames[stage], deltas[stage]);
+    }
+    printPercentiles("total (matched)", totals);
+
+    out << "Recent attempts, ms after finger down:" << std::endl;
+    for (const auto& attempt : attempts) {
+        out << "  #" << attempt.cookie << " " << kOutcomeNames[static_cast<int>(attempt.outcome)];
+        for (size_t stage = 1; stage < kNumStages; stage++) {
+            if (attempt.timestampsNs[stage] == 0) continue;
+            out << " " << kStageNames[stage] << "="
+                << toMs(attempt.timestampsNs[stage] - attempt.timestampsNs[0]);
+        }
+        out << std::endl;
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2024 The LineageOS Project
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+
+// In the order an unlock goes through them
+enum class UnlockStage : size_t {
+    FINGER_DOWN,
+    MASK_WRITTEN,
+    MASK_LIT,
+    CAPTURE_REQUESTED,
+    ACQUIRED,
+    AUTHENTICATED,
+    COUNT,
+};
+
+enum class UnlockOutcome {
+    MATCHED,
+    REJECTED,
+    ERROR,
+    // Replaced by the next finger down before a result came in
+    ABANDONED,
+};
+
+/*
+ * Keeps CLOCK_MONOTONIC timestamps of the stages of the most recent unlock
+ * attempts. Each stage is also an atrace async slice, running from its own mark
+ * to the next one, so an attempt can be lined up against the panel and TA.
+ *
+ * Safe to call from any thread. Marks outside of an attempt, or of a stage the
+ * attempt already reached, are ignored.
+ */
+class UnlockTracer {
+  public:
+    static constexpr size_t kNumAttempts = 32;
+
+    // Starts an attempt at FINGER_DOWN, abandoning the one still open
+    void begin();
+    void mark(UnlockStage stage);
+    void finish(UnlockOutcome outcome);
+
+    // Per-stage percentiles over the recorded attempts, then the attempts
+    void dump(std::ostream& out);
+    void reset();
+
+  private:
+    static constexpr size_t kNumStages = static_cast<size_t>(UnlockStage::COUNT);
+
+    struct Attempt {
+        int32_t cookie{0};
+        // 0 for stages that were not reached
+        std::array<int64_t, kNumStages> timestampsNs{};
+        UnlockOutcome outcome{UnlockOutcome::ABANDONED};
+    };
+
+    void markLocked(UnlockStage stage, int64_t timestampNs);
+    void finishLocked(UnlockOutcome outcome);
+
+    std::mutex mMutex;
+    Attempt mCurrent;
+    bool mActive{false};
+    // Stage whose slice is open
+    size_t mLastStage{0};
+    int32_t mNextCookie{1};
+
+    std::array<Attempt, kNumAttempts> mAttempts;
+    size_t mNumAttempts{0};
+    size_t mNextAttempt{0};
+};
+
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace android {
+namespace hardware {
+
+/*
+ * Fixed size, wait-free queue for exactly one producer and one consumer
+ * thread. Neither side ever blocks or allocates; push() fails when full.
+ */
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+  public:
+    bool push(const T& item) {
+        size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) == N) return false;
+
+        mItems[tail & (N - 1)] = item;
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T* item) {
+        size_t head = mHead.load(std::memory_order_relaxed);
+        if (head == mTail.load(std::memory_order_acquire)) return false;
+
+        *item = mItems[head & (N - 1)];
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only a snapshot when called off the two threads
+    size_t size() const {
+        return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::array<T, N> mItems;
+    // On separate cache lines so the two threads do not contend
+    alignas(64) std::atomic<size_t> mHead{0};
+    alignas(64) std::atomic<size_t> mTail{0};
+};
+
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "android.hardware.memtrack-service.a70q"
+
+#include "Memtrack.h"
+
+#include <android-base/logging.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace memtrack {
+
+static const char* const kNodeNames[] = {"gpumem_mapped", "gpumem_unmapped", "imported_mem"};
+
+// Bounds the number of cached processes, 3 fds each
+static constexpr size_t kMaxProcesses = 512;
+// How long a process without a kgsl directory is not looked at again
+static constexpr auto kAbsentRetry = std::chrono::seconds(1);
+
+Memtrack::Memtrack(const std::string& kgslProcRoot) : mKgslProcRoot(kgslProcRoot) {
+    mProcesses.reserve(kMaxProcesses);
+}
+
+bool Memtrack::open(int pid, ProcessNodes* nodes) {
+    const std::string dir = mKgslProcRoot + "/" + std::to_string(pid) + "/";
+
+    nodes->present = false;
+    for (int i = 0; i < NODE_COUNT; i++) {
+        nodes->fds[i].reset(::open((dir + kNodeNames[i]).c_str(), O_RDONLY | O_CLOEXEC));
+        if (nodes->fds[i].ok()) nodes->present = true;
+    }
+    nodes->checked = std::chrono::steady_clock::now();
+
+    return nodes->present;
+}
+
+void Memtrack::evictOldest() {
+    auto oldest = mProcesses.begin();
+
+    for (auto it = mProcesses.begin(); it != mProcesses.end(); ++it) {
+        if (it->second.lastUse < oldest->second.lastUse) oldest = it;
+    }
+
+    if (oldest != mProcesses.end()) mProcesses.erase(oldest);
+}
+
+Memtrack::ProcessNodes* Memtrack::lookup(int pid) {
+    auto it = mProcesses.find(pid);
+
+    if (it == mProcesses.end()) {
+        if (mProcesses.size() >= kMaxProcesses) evictOldest();
+
+        it = mProcesses.try_emplace(pid).first;
+        open(pid, &it->second);
+    } else if (!it->second.present &&
+               std::chrono::steady_clock::now() - it->second.checked >= kAbsentRetry) {
+        open(pid, &it->second);
+    }
+
+    it->second.lastUse = ++mUseCounter;
+    return &it->second;
+}
+
+static bool preadInt64(int fd, int64_t* value) {
+    char buf[32];
+    ssize_t len = TEMP_FAILURE_RETRY(pread(fd, buf, sizeof(buf) - 1, 0));
+    if (len <= 0) return false;
+
+    buf[len] = '\0';
+    *value = strtoll(buf, nullptr, 10);
+    return true;
+}
+
+bool Memtrack::readNode(int pid, ProcessNodes* nodes, Node node, int64_t* value) {
+    *value = 0;
+
+    if (!nodes->present || !nodes->fds[node].ok()) return false;
+    if (preadInt64(nodes->fds[node].get(), value)) return true;
+
+    // The process exited and its kobject went away, the pid may have been reused
+    if (!open(pid, nodes) || !nodes->fds[node].ok()) return false;
+
+    return preadInt64(nodes->fds[node].get(), value);
+}
+
+ndk::ScopedAStatus Memtrack::getMemory(int pid, MemtrackType type,
+                                       std::vector<MemtrackRecord>* _aidl_return) {
+    if (pid < 0) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    if (type != MemtrackType::OTHER && type != MemtrackType::GL &&
+        type != MemtrackType::GRAPHICS && type != MemtrackType::MULTIMEDIA &&
+        type != MemtrackType::CAMERA) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+
+    _aidl_return->clear();
+
+    if (type != MemtrackType::GL && type != MemtrackType::GRAPHICS) {
+        return ndk::ScopedAStatus::ok();
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    ProcessNodes* nodes = lookup(pid);
+    int64_t size;
+
+    if (!nodes->present) {
+        return ndk::ScopedAStatus::ok();
+    }
+
+    if (type == MemtrackType::GL) {
+        // Mapped kgsl memory already shows up in smaps, unmapped memory does not
+        readNode(pid, nodes, NODE_GPUMEM_MAPPED, &size);
+        _aidl_return->push_back({.flags = MemtrackRecord::FLAG_SMAPS_ACCOUNTED |
+                                          MemtrackRecord::FLAG_PRIVATE |
+                                          MemtrackRecord::FLAG_NONSECURE,
+                                 .sizeInBytes = size});
+
+        readNode(pid, nodes, NODE_GPUMEM_UNMAPPED, &size);
+        _aidl_return->push_back({.flags = MemtrackRecord::FLAG_SMAPS_UNACCOUNTED |
+                                          MemtrackRecord::FLAG_PRIVATE |
+                                          MemtrackRecord::FLAG_NONSECURE,
+                                 .sizeInBytes = size});
+    } else {
+        // dma-bufs imported into the GPU, typically gralloc buffers
+        readNode(pid, nodes, NODE_IMPORTED_MEM, &size);
+        _aidl_return->push_back({.flags = MemtrackRecord::FLAG_SMAPS_UNACCOUNTED |
+                                          MemtrackRecord::FLAG_SHARED |
+                                          MemtrackRecord::FLAG_NONSECURE,
+                                 .sizeInBytes = size});
+    }
+
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus Memtrack::getGpuDeviceInfo(std::vector<DeviceInfo>* _aidl_return) {
+    _aidl_return->clear();
+    _aidl_return->push_back({.id = 0, .name = "kgsl-3d0"});
+    return ndk::ScopedAStatus::ok();
+}
+
+}  // namespace memtrack
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/memtrack/BnMemtrack.h>
+#include <android-base/unique_fd.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace memtrack {
+
+/*
+ * Per-process Adreno memory from /sys/class/kgsl/kgsl/proc/<pid>/.
+ */
+class Memtrack : public BnMemtrack {
+  public:
+    explicit Memtrack(const std::string& kgslProcRoot = "/sys/class/kgsl/kgsl/proc");
+
+    ndk::ScopedAStatus getMemory(int pid, MemtrackType type,
+                                 std::vector<MemtrackRecord>* _aidl_return) override;
+    ndk::ScopedAStatus getGpuDeviceInfo(std::vector<DeviceInfo>* _aidl_return) override;
+
+  private:
+    enum Node {
+        NODE_GPUMEM_MAPPED = 0,
+        NODE_GPUMEM_UNMAPPED,
+        NODE_IMPORTED_MEM,
+        NODE_COUNT,
+    };
+
+    /*
+     * Nodes of one process are opened on first use and kept open. Processes
+     * that never opened kgsl have no directory; that is remembered for a while
+     * so they cost nothing on every sweep.
+     */
+    struct ProcessNodes {
+        ::android::base::unique_fd fds[NODE_COUNT];
+        bool present{false};
+        std::chrono::steady_clock::time_point checked;
+        uint64_t lastUse{0};
+    };
+
+    ProcessNodes* lookup(int pid);
+    bool open(int pid, ProcessNodes* nodes);
+    void evictOldest();
+    bool readNode(int pid, ProcessNodes* nodes, Node node, int64_t* value);
+
+    std::string mKgslProcRoot;
+    std::unordered_map<int, ProcessNodes> mProcesses;
+    uint64_t mUseCounter{0};
+    std::mutex mMutex;
+};
+
+}  // namespace memtrack
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+
+#include <sys/stat.h>
+
+#include <memory>
+#include <string>
+
+#include "Memtrack.h"
+
+using ::aidl::android::hardware::memtrack::Memtrack;
+using ::aidl::android::hardware::memtrack::MemtrackRecord;
+using ::aidl::android::hardware::memtrack::MemtrackType;
+using ::android::base::WriteStringToFile;
+
+// Roughly what `dumpsys meminfo` walks on a busy device
+static constexpr int kNumProcesses = 300;
+// Only some of them ever opened kgsl and have a directory
+static constexpr int kGpuProcessEvery = 3;
+
+/*
+ * A kgsl proc tree in a temporary directory, kNumProcesses pids starting at 1.
+ */
+class FakeKgslProc {
+  public:
+    FakeKgslProc() {
+        for (int pid = 1; pid <= kNumProcesses; pid++) {
+            if (pid % kGpuProcessEvery != 0) continue;
+
+            const std::string dir = std::string(mDir.path) + "/" + std::to_string(pid);
+            mkdir(dir.c_str(), 0755);
+            WriteStringToFile(std::to_string(pid * 4096) + "\n", dir + "/gpumem_mapped");
+            WriteStringToFile(std::to_string(pid * 8192) + "\n", dir + "/gpumem_unmapped");
+            WriteStringToFile(std::to_string(pid * 1024) + "\n", dir + "/imported_mem");
+        }
+    }
+
+    const char* path() const { return mDir.path; }
+
+  private:
+    TemporaryDir mDir;
+};
+
+static void sweep(Memtrack* memtrack, std::vector<MemtrackRecord>* records) {
+    for (int pid = 1; pid <= kNumProcesses; pid++) {
+        memtrack->getMemory(pid, MemtrackType::GL, records);
+        benchmark::DoNotOptimize(records->data());
+        memtrack->getMemory(pid, MemtrackType::GRAPHICS, records);
+        benchmark::DoNotOptimize(records->data());
+    }
+}
+
+// Steady state, every node is already open
+static void BM_GetMemorySweep(benchmark::State& state) {
+    FakeKgslProc proc;
+    Memtrack memtrack(proc.path());
+    std::vector<MemtrackRecord> records;
+
+    sweep(&memtrack, &records);
+    for (auto _ : state) {
+        sweep(&memtrack, &records);
+    }
+    state.SetItemsProcessed(state.iterations() * kNumProcesses);
+}
+BENCHMARK(BM_GetMemorySweep);
+
+// First sweep after the service started, every node is opened on the way
+static void BM_GetMemorySweepCold(benchmark::State& state) {
+    FakeKgslProc proc;
+    std::vector<MemtrackRecord> records;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto memtrack = std::make_unique<Memtrack>(proc.path());
+        state.ResumeTiming();
+
+        sweep(memtrack.get(), &records);
+
+        state.PauseTiming();
+        memtrack.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * kNumProcesses);
+}
+BENCHMARK(BM_GetMemorySweepCold);
+
+BENCHMARK_MAIN();
@@ -36,14 +36,36 @@
 
 #define MIN(x, y) (((x) > (y)) ? (y) : (x))
 
+enum video_codec {
+    VIDEO_CODEC_UNKNOWN = 0,
+    VIDEO_CODEC_AVC,
+    VIDEO_CODEC_HEVC,
+    VIDEO_CODEC_VP8,
+    VIDEO_CODEC_VP9,
+    VIDEO_CODEC_MPEG4,
+};
+
+/*
+ * width, height and fps are 0 and codec is VIDEO_CODEC_UNKNOWN when the
+ * client did not supply them in the metadata string. state is left as the
+ * caller initialized it.
+ */
 struct video_encode_metadata_t {
     int hint_id;
     int state;
+    int width;
+    int height;
+    int fps;
+    enum video_codec codec;
 };
 
 struct video_decode_metadata_t {
     int hint_id;
     int state;
+    int width;
+    int height;
+    int fps;
+    enum video_codec codec;
 };
 
 int parse_metadata(char* metadata, char** metadata_saveptr, char* attribute,
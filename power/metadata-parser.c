@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 #include "metadata-defs.h"
 
@@ -57,6 +58,48 @@ int parse_metadata(char* metadata, char** metadata_saveptr, char* attribute,
     return METADATA_PARSING_CONTINUE;
 }
 
+static enum video_codec parse_video_codec(const char* value) {
+    if (strcasecmp(value, "avc") == 0 || strcasecmp(value, "h264") == 0) return VIDEO_CODEC_AVC;
+    if (strcasecmp(value, "hevc") == 0 || strcasecmp(value, "h265") == 0) return VIDEO_CODEC_HEVC;
+    if (strcasecmp(value, "vp8") == 0) return VIDEO_CODEC_VP8;
+    if (strcasecmp(value, "vp9") == 0) return VIDEO_CODEC_VP9;
+    if (strcasecmp(value, "mpeg4") == 0) return VIDEO_CODEC_MPEG4;
+
+    return VIDEO_CODEC_UNKNOWN;
+}
+
+static int attribute_is(const char* attribute, const char* name) {
+    return strlen(attribute) == strlen(name) && strncmp(attribute, name, strlen(name)) == 0;
+}
+
+/*
+ * Fills in whichever of the common video attributes is named by attribute.
+ * Returns 1 if the attribute was recognized.
+ */
+static int parse_video_attribute(const char* attribute, const char* value, int* hint_id,
+                                 int* state, int* width, int* height, int* fps,
+                                 enum video_codec* codec) {
+    if (strlen(value) == 0) return 0;
+
+    if (attribute_is(attribute, "hint_id")) {
+        *hint_id = atoi(value);
+    } else if (attribute_is(attribute, "state")) {
+        *state = atoi(value);
+    } else if (attribute_is(attribute, "width")) {
+        *width = atoi(value);
+    } else if (attribute_is(attribute, "height")) {
+        *height = atoi(value);
+    } else if (attribute_is(attribute, "fps")) {
+        *fps = atoi(value);
+    } else if (attribute_is(attribute, "codec")) {
+        *codec = parse_video_codec(value);
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
 int parse_video_encode_metadata(char* metadata,
                                 struct video_encode_metadata_t* video_encode_metadata) {
     char attribute[1024], value[1024], *saveptr;
@@ -65,19 +108,10 @@ int parse_video_encode_metadata(char* metadata,
 
     while ((parsing_status = parse_metadata(temp_metadata, &saveptr, attribute, sizeof(attribute),
                                             value, sizeof(value))) == METADATA_PARSING_CONTINUE) {
-        if (strlen(attribute) == strlen("hint_id") &&
-            (strncmp(attribute, "hint_id", strlen("hint_id")) == 0)) {
-            if (strlen(value) > 0) {
-                video_encode_metadata->hint_id = atoi(value);
-            }
-        }
-
-        if (strlen(attribute) == strlen("state") &&
-            (strncmp(attribute, "state", strlen("state")) == 0)) {
-            if (strlen(value) > 0) {
-                video_encode_metadata->state = atoi(value);
-            }
-        }
+        parse_video_attribute(attribute, value, &video_encode_metadata->hint_id,
+                              &video_encode_metadata->state, &video_encode_metadata->width,
+                              &video_encode_metadata->height, &video_encode_metadata->fps,
+                              &video_encode_metadata->codec);
 
         temp_metadata = NULL;
     }
@@ -95,19 +129,10 @@ int parse_video_decode_metadata(char* metadata,
 
     while ((parsing_status = parse_metadata(temp_metadata, &saveptr, attribute, sizeof(attribute),
                                             value, sizeof(value))) == METADATA_PARSING_CONTINUE) {
-        if (strlen(attribute) == strlen("hint_id") &&
-            (strncmp(attribute, "hint_id", strlen("hint_id")) == 0)) {
-            if (strlen(value) > 0) {
-                video_decode_metadata->hint_id = atoi(value);
-            }
-        }
-
-        if (strlen(attribute) == strlen("state") &&
-            (strncmp(attribute, "state", strlen("state")) == 0)) {
-            if (strlen(value) > 0) {
-                video_decode_metadata->state = atoi(value);
-            }
-        }
+        parse_video_attribute(attribute, value, &video_decode_metadata->hint_id,
+                              &video_decode_metadata->state, &video_decode_metadata->width,
+                              &video_decode_metadata->height, &video_decode_metadata->fps,
+                              &video_decode_metadata->codec);
 
         temp_metadata = NULL;
     }
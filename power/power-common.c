@@ -44,6 +44,7 @@
 #include <log/log.h>
 
 #include "hint-data.h"
+#include "metadata-defs.h"
 #include "performance.h"
 #include "power-common.h"
 #include "utils.h"
@@ -51,6 +52,147 @@
 static struct hint_handles handles[NUM_HINTS];
 static int handleER = 0;
 
+/*
+ * Video sessions are sorted into profiles by pixel rate (width * height * fps),
+ * so that ordinary streaming playback does not pay for the boost a 4K
+ * recording needs.
+ */
+enum video_profile_id {
+    VIDEO_PROFILE_LIGHT = 0,
+    VIDEO_PROFILE_MEDIUM,
+    VIDEO_PROFILE_HEAVY,
+};
+
+#define VIDEO_DEFAULT_FPS 30
+#define VIDEO_PIXEL_RATE_1080P30 (1920LL * 1088 * 30)
+#define VIDEO_PIXEL_RATE_1080P60 (1920LL * 1088 * 60)
+#define VIDEO_PIXEL_RATE_4K30 (3840LL * 2160 * 30)
+
+/* Floors for CPUBW_HWMON_MIN_FREQ are in MB/s, MIN_FREQ_BIG_CORE_0 in MHz */
+static int video_resources_medium[] = {
+        CPUBW_HWMON_MIN_FREQ, 1720,
+};
+
+static int video_resources_heavy[] = {
+        CPUBW_HWMON_MIN_FREQ, 5161,
+        MIN_FREQ_BIG_CORE_0, 1209,
+};
+
+static const char* video_profile_names[] = {"light", "medium", "heavy"};
+
+static long long video_pixel_rate(int width, int height, int fps) {
+    if (fps <= 0) fps = VIDEO_DEFAULT_FPS;
+    return (long long)width * height * fps;
+}
+
+static enum video_profile_id select_video_encode_profile(
+        struct video_encode_metadata_t* metadata) {
+    long long rate = video_pixel_rate(metadata->width, metadata->height, metadata->fps);
+
+    /* Clients that do not report a resolution keep the old fixed boost */
+    if (rate <= 0) return VIDEO_PROFILE_MEDIUM;
+
+    /* HEVC and VP9 encode cost noticeably more per pixel than AVC */
+    if (metadata->codec == VIDEO_CODEC_HEVC || metadata->codec == VIDEO_CODEC_VP9)
+        rate = rate * 3 / 2;
+
+    if (rate >= VIDEO_PIXEL_RATE_4K30) return VIDEO_PROFILE_HEAVY;
+    if (rate > VIDEO_PIXEL_RATE_1080P30 / 2) return VIDEO_PROFILE_MEDIUM;
+    return VIDEO_PROFILE_LIGHT;
+}
+
+static enum video_profile_id select_video_decode_profile(
+        struct video_decode_metadata_t* metadata) {
+    long long rate = video_pixel_rate(metadata->width, metadata->height, metadata->fps);
+
+    /* Decode is done by the VPU; only very high rates need the bus held up */
+    if (rate > VIDEO_PIXEL_RATE_4K30) return VIDEO_PROFILE_HEAVY;
+    if (rate > VIDEO_PIXEL_RATE_1080P60) return VIDEO_PROFILE_MEDIUM;
+    return VIDEO_PROFILE_LIGHT;
+}
+
+static void apply_video_profile(int hint_id, enum video_profile_id profile) {
+    /* A session may be reconfigured, drop whatever it held before */
+    if (is_hint_action_active(hint_id)) undo_hint_action(hint_id);
+
+    ALOGI("Video hint %X: %s profile", hint_id, video_profile_names[profile]);
+
+    switch (profile) {
+        case VIDEO_PROFILE_MEDIUM:
+            perform_hint_action(hint_id, video_resources_medium,
+                                ARRAY_SIZE(video_resources_medium));
+            break;
+        case VIDEO_PROFILE_HEAVY:
+            perform_hint_action(hint_id, video_resources_heavy,
+                                ARRAY_SIZE(video_resources_heavy));
+            break;
+        default:
+            break;
+    }
+}
+
+static void release_video_profile(int hint_id) {
+    if (is_hint_action_active(hint_id)) undo_hint_action(hint_id);
+}
+
+static int process_video_encode_hint(void* data) {
+    char metadata[1024];
+    /* A payload without state= must not release the session by accident */
+    struct video_encode_metadata_t video_encode_metadata = {.state = -1};
+
+    if (!data) return HINT_NONE;
+
+    strlcpy(metadata, (char*)data, sizeof(metadata));
+
+    if (parse_video_encode_metadata(metadata, &video_encode_metadata) == -1) {
+        ALOGE("Error occurred while parsing metadata.");
+        return HINT_NONE;
+    }
+
+    if (video_encode_metadata.hint_id == 0)
+        video_encode_metadata.hint_id = DEFAULT_VIDEO_ENCODE_HINT_ID;
+
+    if (video_encode_metadata.state == 1) {
+        apply_video_profile(video_encode_metadata.hint_id,
+                            select_video_encode_profile(&video_encode_metadata));
+    } else if (video_encode_metadata.state == 0) {
+        release_video_profile(video_encode_metadata.hint_id);
+    } else {
+        return HINT_NONE;
+    }
+
+    return HINT_HANDLED;
+}
+
+static int process_video_decode_hint(void* data) {
+    char metadata[1024];
+    /* A payload without state= must not release the session by accident */
+    struct video_decode_metadata_t video_decode_metadata = {.state = -1};
+
+    if (!data) return HINT_NONE;
+
+    strlcpy(metadata, (char*)data, sizeof(metadata));
+
+    if (parse_video_decode_metadata(metadata, &video_decode_metadata) == -1) {
+        ALOGE("Error occurred while parsing metadata.");
+        return HINT_NONE;
+    }
+
+    if (video_decode_metadata.hint_id == 0)
+        video_decode_metadata.hint_id = DEFAULT_VIDEO_DECODE_HINT_ID;
+
+    if (video_decode_metadata.state == 1) {
+        apply_video_profile(video_decode_metadata.hint_id,
+                            select_video_decode_profile(&video_decode_metadata));
+    } else if (video_decode_metadata.state == 0) {
+        release_video_profile(video_decode_metadata.hint_id);
+    } else {
+        return HINT_NONE;
+    }
+
+    return HINT_HANDLED;
+}
+
 void power_init() {
     ALOGI("Initing");
 
@@ -74,9 +216,18 @@ void power_hint(power_hint_t hint, void* data) {
         case POWER_HINT_VR_MODE:
             ALOGI("VR mode power hint not handled in power_hint_override");
             break;
+        /*
+         * Only reachable through the legacy power_hint() path. The AIDL
+         * service has no mode or boost carrying the metadata string, so
+         * nothing calls these from Power.cpp yet.
+         */
+        case POWER_HINT_VIDEO_DECODE:
+            process_video_decode_hint(data);
+            break;
+        case POWER_HINT_VIDEO_ENCODE:
+            if (process_video_encode_hint(data) == HINT_HANDLED) break;
         // fall through below, hints will fail if not defined in powerhint.xml
         case POWER_HINT_SUSTAINED_PERFORMANCE:
-        case POWER_HINT_VIDEO_ENCODE:
             if (data) {
                 if (handles[hint].ref_count == 0)
                     handles[hint].handle = perf_hint_enable((AOSP_DELTA + hint), 0);
@@ -342,6 +342,14 @@ void undo_hint_action(int hint_id) {
     }
 }
 
+int is_hint_action_active(int hint_id) {
+    struct hint_data temp_hint_data = {.hint_id = hint_id};
+
+    if (!active_hint_list_head.compare) return 0;
+
+    return find_node(&active_hint_list_head, &temp_hint_data) != NULL;
+}
+
 /*
  * Used to release initial lock holding
  * two cores online when the display is on
@@ -38,6 +38,7 @@ int is_schedutil_governor(char*);
 
 int perform_hint_action(int hint_id, int resource_values[], int num_resources);
 void undo_hint_action(int hint_id);
+int is_hint_action_active(int hint_id);
 void undo_initial_hint_action();
 void release_request(int lock_handle);
 void interaction(int duration, int num_args, int opt_list[]);
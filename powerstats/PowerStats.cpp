@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "android.hardware.power.stats-service.a70q"
+
+#include "PowerStats.h"
+
+#include <android-base/logging.h>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace stats {
+
+// SDM675: cpu0-5 are Kryo 460 Silver, cpu6-7 are Kryo 460 Gold
+static constexpr int kNumCpus = 8;
+
+// RPMh stats count in ticks of the 19.2 MHz always-on timer
+static constexpr uint64_t kRpmhTicksPerMs = 19200;
+
+static uint64_t rpmhTicksToMs(uint64_t ticks) {
+    return ticks / kRpmhTicksPerMs;
+}
+
+static std::vector<RpmhStateConfig> masterSleepConfig(const std::string& master) {
+    return {{
+            .name = "Sleep",
+            .header = master,
+            .entryCountPrefix = "Sleep Count:",
+            .totalTimePrefix = "Sleep Accumulated Duration:",
+            .lastEntryPrefix = "Sleep Last Entered At:",
+            .timeToMs = rpmhTicksToMs,
+    }};
+}
+
+PowerStats::PowerStats() {
+    addEntity(std::make_unique<TimeInStateReader>(
+            "CPUCL0", "/sys/devices/system/cpu/cpufreq/policy0/stats/time_in_state"));
+    addEntity(std::make_unique<TimeInStateReader>(
+            "CPUCL1", "/sys/devices/system/cpu/cpufreq/policy6/stats/time_in_state"));
+
+    for (int cpu = 0; cpu < kNumCpus; cpu++) {
+        addEntity(std::make_unique<CpuIdleReader>("CPU" + std::to_string(cpu), cpu));
+    }
+
+    addEntity(std::make_unique<KgslReader>("GPU", "/sys/class/kgsl/kgsl-3d0"));
+
+    addEntity(std::make_unique<DevfreqReader>(
+            "DDR", "/sys/class/devfreq/soc:qcom,cpu-llcc-ddr-bw"));
+
+    // system_sleep/stats reports the RPMh low power modes already in ms
+    addEntity(std::make_unique<RpmhReader>(
+            "SoC", "/sys/power/system_sleep/stats",
+            std::vector<RpmhStateConfig>{
+                    {.name = "AOSD",
+                     .header = "RPM Mode:aosd",
+                     .entryCountPrefix = "count:",
+                     .totalTimePrefix = "actual last sleep(msec):"},
+                    {.name = "CXSD",
+                     .header = "RPM Mode:cxsd",
+                     .entryCountPrefix = "count:",
+                     .totalTimePrefix = "actual last sleep(msec):"},
+            }));
+
+    for (const char* master : {"APSS", "MPSS", "ADSP", "CDSP", "TZ"}) {
+        addEntity(std::make_unique<RpmhReader>(master, "/sys/power/rpmh_stats/master_stats",
+                                               masterSleepConfig(master)));
+    }
+}
+
+void PowerStats::addEntity(std::unique_ptr<ResidencyReader> reader) {
+    if (reader->states().empty()) {
+        LOG(WARNING) << "No states found for " << reader->name() << ", skipping";
+        return;
+    }
+
+    mEntities.push_back({.id = static_cast<int32_t>(mEntities.size()),
+                         .name = reader->name(),
+                         .states = reader->states()});
+    mReaders.push_back(std::move(reader));
+}
+
+ndk::ScopedAStatus PowerStats::getPowerEntityInfo(std::vector<PowerEntity>* _aidl_return) {
+    *_aidl_return = mEntities;
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus PowerStats::getStateResidency(const std::vector<int32_t>& in_powerEntityIds,
+                                                 std::vector<StateResidencyResult>* _aidl_return) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // An empty list means all entities
+    if (in_powerEntityIds.empty()) {
+        _aidl_return->reserve(mReaders.size());
+        for (size_t id = 0; id < mReaders.size(); id++) {
+            StateResidencyResult result{.id = static_cast<int32_t>(id)};
+            if (mReaders[id]->read(&result.stateResidencyData)) {
+                _aidl_return->push_back(std::move(result));
+            }
+        }
+        return ndk::ScopedAStatus::ok();
+    }
+
+    _aidl_return->reserve(in_powerEntityIds.size());
+    for (int32_t id : in_powerEntityIds) {
+        if (id < 0 || static_cast<size_t>(id) >= mReaders.size()) {
+            return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+        }
+
+        StateResidencyResult result{.id = id};
+        if (!mReaders[id]->read(&result.stateResidencyData)) {
+            return ndk::ScopedAStatus::fromStatus(STATUS_FAILED_TRANSACTION);
+        }
+        _aidl_return->push_back(std::move(result));
+    }
+
+    return ndk::ScopedAStatus::ok();
+}
+
+// SDM675 has no on-device power monitor, so there are no meters or consumers
+ndk::ScopedAStatus PowerStats::getEnergyConsumerInfo(std::vector<EnergyConsumer>* _aidl_return) {
+    _aidl_return->clear();
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus PowerStats::getEnergyConsumed(const std::vector<int32_t>& in_energyConsumerIds,
+                                                 std::vector<EnergyConsumerResult>* /*_aidl_return*/) {
+    if (!in_energyConsumerIds.empty()) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus PowerStats::getEnergyMeterInfo(std::vector<Channel>* _aidl_return) {
+    _aidl_return->clear();
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus PowerStats::readEnergyMeter(const std::vector<int32_t>& in_channelIds,
+                                               std::vector<EnergyMeasurement>* /*_aidl_return*/) {
+    if (!in_channelIds.empty()) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+    return ndk::ScopedAStatus::ok();
+}
+
+}  // namespace stats
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
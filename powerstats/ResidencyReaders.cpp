@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "android.hardware.power.stats-service.a70q"
+
+#include "ResidencyReaders.h"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/strings.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace stats {
+
+static constexpr size_t kInitialBufferSize = 4096;
+
+PersistentNode::PersistentNode(const std::string& path)
+    : mPath(path), mFd(open(path.c_str(), O_RDONLY | O_CLOEXEC)), mBuffer(kInitialBufferSize) {
+    if (!mFd.ok()) {
+        PLOG(WARNING) << "Failed to open " << path;
+    }
+}
+
+char* PersistentNode::read() {
+    if (!mFd.ok()) return nullptr;
+
+    size_t total = 0;
+    for (;;) {
+        // Keep one byte for the terminator, grow only if the node outgrew us
+        if (total + 1 >= mBuffer.size()) mBuffer.resize(mBuffer.size() * 2);
+
+        ssize_t len = TEMP_FAILURE_RETRY(
+                pread(mFd.get(), mBuffer.data() + total, mBuffer.size() - total - 1, total));
+        if (len < 0) {
+            PLOG(ERROR) << "Failed to read " << mPath;
+            return nullptr;
+        }
+        if (len == 0) break;
+        total += len;
+    }
+
+    mBuffer[total] = '\0';
+    return mBuffer.data();
+}
+
+bool PersistentNode::readUint64(uint64_t* value) {
+    const char* buf = read();
+    if (buf == nullptr) return false;
+
+    char* end;
+    *value = strtoull(buf, &end, 0);
+    return end != buf;
+}
+
+/*
+ * Calls fn for every line of buf, with the line terminator replaced by NUL.
+ */
+template <typename F>
+static void forEachLine(char* buf, F fn) {
+    while (*buf != '\0') {
+        char* eol = strchr(buf, '\n');
+        if (eol != nullptr) *eol = '\0';
+        fn(buf);
+        if (eol == nullptr) break;
+        buf = eol + 1;
+    }
+}
+
+static char* skipSpaces(char* s) {
+    while (*s == ' ' || *s == '\t') s++;
+    return s;
+}
+
+static void resetResidencies(const std::vector<State>& states,
+                             std::vector<StateResidency>* residencies) {
+    residencies->resize(states.size());
+    for (size_t i = 0; i < states.size(); i++) {
+        (*residencies)[i] = {.id = states[i].id};
+    }
+}
+
+TimeInStateReader::TimeInStateReader(const std::string& name, const std::string& path)
+    : ResidencyReader(name), mNode(path) {
+    const char* buf = mNode.read();
+    if (buf == nullptr) return;
+
+    for (const auto& line : ::android::base::Split(buf, "\n")) {
+        auto fields = ::android::base::Split(line, " ");
+        if (fields.size() != 2) continue;
+
+        mStates.push_back({.id = static_cast<int32_t>(mStates.size()), .name = fields[0]});
+    }
+}
+
+bool TimeInStateReader::read(std::vector<StateResidency>* residencies) {
+    char* buf = mNode.read();
+    if (buf == nullptr) return false;
+
+    resetResidencies(mStates, residencies);
+
+    size_t index = 0;
+    forEachLine(buf, [&](char* line) {
+        char* end;
+        if (index >= mStates.size()) return;
+        strtoull(line, &end, 10);
+        if (end == line) return;
+
+        // time_in_state is in USER_HZ (10ms) units
+        (*residencies)[index++].totalTimeInStateMs = strtoull(end, nullptr, 10) * 10;
+    });
+
+    return index == mStates.size();
+}
+
+CpuIdleReader::CpuIdleReader(const std::string& name, int cpu) : ResidencyReader(name) {
+    const std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpuidle/state";
+
+    for (int i = 0;; i++) {
+        const std::string dir = base + std::to_string(i);
+        std::string stateName;
+
+        if (!::android::base::ReadFileToString(dir + "/name", &stateName)) break;
+
+        mStates.push_back({.id = i, .name = ::android::base::Trim(stateName)});
+        mUsage.push_back(std::make_unique<PersistentNode>(dir + "/usage"));
+        mTime.push_back(std::make_unique<PersistentNode>(dir + "/time"));
+    }
+}
+
+bool CpuIdleReader::read(std::vector<StateResidency>* residencies) {
+    bool ok = true;
+
+    resetResidencies(mStates, residencies);
+
+    for (size_t i = 0; i < mStates.size(); i++) {
+        uint64_t usage, timeUs;
+
+        if (!mUsage[i]->readUint64(&usage) || !mTime[i]->readUint64(&timeUs)) {
+            ok = false;
+            continue;
+        }
+
+        (*residencies)[i].totalStateEntryCount = usage;
+        (*residencies)[i].totalTimeInStateMs = timeUs / 1000;
+    }
+
+    return ok;
+}
+
+KgslReader::KgslReader(const std::string& name, const std::string& dir)
+    : ResidencyReader(name), mClockStats(dir + "/gpu_clock_stats") {
+    std::string freqs;
+
+    if (!::android::base::ReadFileToString(dir + "/gpu_available_frequencies", &freqs)) {
+        PLOG(WARNING) << "Failed to read GPU frequencies from " << dir;
+        return;
+    }
+
+    // Listed in power level order, which is the order of gpu_clock_stats
+    for (const auto& freq : ::android::base::Split(::android::base::Trim(freqs), " ")) {
+        if (freq.empty()) continue;
+
+        mStates.push_back({.id = static_cast<int32_t>(mStates.size()), .name = freq});
+    }
+}
+
+bool KgslReader::read(std::vector<StateResidency>* residencies) {
+    char* buf = mClockStats.read();
+    if (buf == nullptr) return false;
+
+    resetResidencies(mStates, residencies);
+
+    for (size_t i = 0; i < mStates.size(); i++) {
+        char* end;
+        uint64_t busyUs = strtoull(buf, &end, 10);
+        if (end == buf) return false;
+
+        (*residencies)[i].totalTimeInStateMs = busyUs / 1000;
+        buf = end;
+    }
+
+    return true;
+}
+
+/*
+ * Splits a trans_stat row into its frequency and the text after the colon,
+ * returns false for the header and summary lines.
+ */
+static bool parseTransStatRow(char* line, uint64_t* freq, char** rest) {
+    char* colon = strchr(line, ':');
+    if (colon == nullptr) return false;
+
+    char* start = skipSpaces(line);
+    if (*start == '*') start = skipSpaces(start + 1);
+
+    char* end;
+    *freq = strtoull(start, &end, 10);
+    if (end == start || skipSpaces(end) != colon) return false;
+
+    *rest = colon + 1;
+    return true;
+}
+
+DevfreqReader::DevfreqReader(const std::string& name, const std::string& dir)
+    : ResidencyReader(name), mTransStat(dir + "/trans_stat") {
+    char* buf = mTransStat.read();
+    if (buf == nullptr) return;
+
+    forEachLine(buf, [&](char* line) {
+        uint64_t freq;
+        char* rest;
+
+        if (!parseTransStatRow(line, &freq, &rest)) return;
+
+        mStates.push_back({.id = static_cast<int32_t>(mStates.size()), .name = std::to_string(freq)});
+    });
+}
+
+bool DevfreqReader::read(std::vector<StateResidency>* residencies) {
+    char* buf = mTransStat.read();
+    if (buf == nullptr) return false;
+
+    resetResidencies(mStates, residencies);
+
+    size_t row = 0;
+    forEachLine(buf, [&](char* line) {
+        uint64_t freq;
+        char* rest;
+
+        if (row >= mStates.size() || !parseTransStatRow(line, &freq, &rest)) return;
+
+        // Column j counts transitions from this row into state j
+        for (size_t col = 0; col < mStates.size(); col++) {
+            (*residencies)[col].totalStateEntryCount += strtoull(rest, &rest, 10);
+        }
+        (*residencies)[row++].totalTimeInStateMs = strtoull(rest, nullptr, 10);
+    });
+
+    return row == mStates.size();
+}
+
+RpmhReader::RpmhReader(const std::string& name, const std::string& path,
+                       std::vector<RpmhStateConfig> configs)
+    : ResidencyReader(name), mNode(path), mConfigs(std::move(configs)) {
+    for (const auto& config : mConfigs) {
+        mStates.push_back({.id = static_cast<int32_t>(mStates.size()), .name = config.name});
+    }
+}
+
+static bool parsePrefixed(const char* line, const std::string& prefix, uint64_t* value) {
+    if (prefix.empty() || strncmp(line, prefix.c_str(), prefix.size()) != 0) return false;
+
+    *value = strtoull(line + prefix.size(), nullptr, 0);
+    return true;
+}
+
+bool RpmhReader::read(std::vector<StateResidency>* residencies) {
+    char* buf = mNode.read();
+    if (buf == nullptr) return false;
+
+    resetResidencies(mStates, residencies);
+
+    ssize_t current = -1;
+    forEachLine(buf, [&](char* line) {
+        line = skipSpaces(line);
+
+        for (size_t i = 0; i < mConfigs.size(); i++) {
+            if (mConfigs[i].header == line) {
+                current = i;
+                return;
+            }
+        }
+
+        if (current < 0) return;
+
+        const auto& config = mConfigs[current];
+        auto& residency = (*residencies)[current];
+        uint64_t value;
+
+        if (parsePrefixed(line, config.entryCountPrefix, &value)) {
+            residency.totalStateEntryCount = value;
+        } else if (parsePrefixed(line, config.totalTimePrefix, &value)) {
+            residency.totalTimeInStateMs = config.timeToMs ? config.timeToMs(value) : value;
+        } else if (parsePrefixed(line, config.lastEntryPrefix, &value)) {
+            residency.lastEntryTimestampMs = config.timeToMs ? config.timeToMs(value) : value;
+        } else if ((strchr(line, ':') == nullptr && *line != '\0') ||
+                   strncmp(line, "RPM Mode:", strlen("RPM Mode:")) == 0) {
+            // An unknown block header ends the current state
+            current = -1;
+        }
+    });
+
+    return true;
+}
+
+}  // namespace stats
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
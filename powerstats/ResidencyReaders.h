@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/power/stats/State.h>
+#include <aidl/android/hardware/power/stats/StateResidency.h>
+#include <android-base/unique_fd.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using ::aidl::android::hardware::power::stats::State;
+using ::aidl::android::hardware::power::stats::StateResidency;
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace stats {
+
+/*
+ * A sysfs node that is opened once and re-read from offset 0 on every query,
+ * so that sampling residencies never goes through path lookup again.
+ */
+class PersistentNode {
+  public:
+    explicit PersistentNode(const std::string& path);
+
+    bool isValid() const { return mFd.ok(); }
+    const std::string& path() const { return mPath; }
+
+    // Reads the whole node into an internal buffer, returns nullptr on error.
+    char* read();
+    bool readUint64(uint64_t* value);
+
+  private:
+    std::string mPath;
+    ::android::base::unique_fd mFd;
+    std::vector<char> mBuffer;
+};
+
+/*
+ * Backs exactly one power entity. The state table is discovered once in the
+ * constructor; read() only refreshes the counters of the presized output.
+ */
+class ResidencyReader {
+  public:
+    virtual ~ResidencyReader() = default;
+
+    const std::string& name() const { return mName; }
+    const std::vector<State>& states() const { return mStates; }
+
+    virtual bool read(std::vector<StateResidency>* residencies) = 0;
+
+  protected:
+    explicit ResidencyReader(const std::string& name) : mName(name) {}
+
+    std::string mName;
+    std::vector<State> mStates;
+};
+
+/*
+ * cpufreq policy stats/time_in_state: "<freq> <time in 10ms>" per line.
+ */
+class TimeInStateReader : public ResidencyReader {
+  public:
+    TimeInStateReader(const std::string& name, const std::string& path);
+    bool read(std::vector<StateResidency>* residencies) override;
+
+  private:
+    PersistentNode mNode;
+};
+
+/*
+ * cpuidle states of a single core, counted through stateN/usage and
+ * stateN/time (microseconds).
+ */
+class CpuIdleReader : public ResidencyReader {
+  public:
+    CpuIdleReader(const std::string& name, int cpu);
+    bool read(std::vector<StateResidency>* residencies) override;
+
+  private:
+    std::vector<std::unique_ptr<PersistentNode>> mUsage;
+    std::vector<std::unique_ptr<PersistentNode>> mTime;
+};
+
+/*
+ * kgsl per power level busy time from gpu_clock_stats (microseconds), with
+ * states named after gpu_available_frequencies.
+ */
+class KgslReader : public ResidencyReader {
+  public:
+    KgslReader(const std::string& name, const std::string& dir);
+    bool read(std::vector<StateResidency>* residencies) override;
+
+  private:
+    PersistentNode mClockStats;
+};
+
+/*
+ * devfreq trans_stat: one row per frequency with the transition counts into
+ * every other frequency and the time spent at it in ms as the last column.
+ */
+class DevfreqReader : public ResidencyReader {
+  public:
+    DevfreqReader(const std::string& name, const std::string& dir);
+    bool read(std::vector<StateResidency>* residencies) override;
+
+  private:
+    PersistentNode mTransStat;
+};
+
+/*
+ * Block formatted RPMh statistics (system_sleep/stats, rpmh_stats/master_stats).
+ * Each state is located by a header line and its counters by line prefixes.
+ */
+struct RpmhStateConfig {
+    std::string name;
+    std::string header;
+    std::string entryCountPrefix;
+    std::string totalTimePrefix;
+    std::string lastEntryPrefix;
+    std::function<uint64_t(uint64_t)> timeToMs;
+};
+
+class RpmhReader : public ResidencyReader {
+  public:
+    RpmhReader(const std::string& name, const std::string& path,
+               std::vector<RpmhStateConfig> configs);
+    bool read(std::vector<StateResidency>* residencies) override;
+
+  private:
+    PersistentNode mNode;
+    std::vector<RpmhStateConfig> mConfigs;
+};
+
+}  // namespace stats
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "DirectChannel.h"
+
+#include <log/log.h>
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstring>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+using ::android::hardware::sensors::V1_0::EventPayload;
+using ::android::hardware::sensors::V1_0::SensorsEventFormatOffset;
+using ::android::hardware::sensors::V1_0::SharedMemFormat;
+using ::android::hardware::sensors::V1_0::SharedMemType;
+
+static constexpr size_t offsetOf(SensorsEventFormatOffset offset) {
+    return static_cast<size_t>(offset);
+}
+
+static constexpr size_t kRecordSize = offsetOf(SensorsEventFormatOffset::TOTAL_LENGTH);
+static constexpr size_t kDataSize =
+    offsetOf(SensorsEventFormatOffset::RESERVED) - offsetOf(SensorsEventFormatOffset::DATA);
+
+static_assert(sizeof(EventPayload::data) == kDataSize, "payload does not match the direct layout");
+
+DirectChannel::DirectChannel(int32_t handle, const SharedMemInfo& mem)
+    : mHandle(handle), mBase(nullptr), mSize(0), mNumRecords(0), mWriteIndex(0), mCounter(1) {
+    if (!isSupported(mem)) return;
+
+    map(mem.memoryHandle->data[0], mem.size);
+}
+
+DirectChannel::DirectChannel(int32_t handle, int fd, size_t size)
+    : mHandle(handle), mBase(nullptr), mSize(0), mNumRecords(0), mWriteIndex(0), mCounter(1) {
+    map(fd, size);
+}
+
+DirectChannel::~DirectChannel() {
+    if (mBase != nullptr) munmap(mBase, mSize);
+}
+
+bool DirectChannel::isSupported(const SharedMemInfo& mem) {
+    return mem.type == SharedMemType::ASHMEM && mem.format == SharedMemFormat::SENSORS_EVENT &&
+           mem.memoryHandle != nullptr && mem.memoryHandle->numFds >= 1 &&
+           mem.size >= kRecordSize;
+}
+
+void DirectChannel::map(int fd, size_t size) {
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        ALOGE("failed to map direct channel %d: %d", mHandle, errno);
+        return;
+    }
+
+    mBase = static_cast<uint8_t*>(base);
+    mSize = size;
+    mNumRecords = size / kRecordSize;
+}
+
+/*
+ * The reader polls the atomic counter of the next record, so it is cleared
+ * before the payload changes and published last, with release ordering.
+ */
+void DirectChannel::write(const Event& event, int32_t reportToken) {
+    if (mBase == nullptr) return;
+
+    uint8_t* record = mBase + mWriteIndex * kRecordSize;
+    auto* counter = reinterpret_cast<std::atomic<uint32_t>*>(
+        record + offsetOf(SensorsEventFormatOffset::ATOMIC_COUNTER));
+
+    counter->store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    int32_t size = kRecordSize;
+    int32_t type = static_cast<int32_t>(event.sensorType);
+    memcpy(record + offsetOf(SensorsEventFormatOffset::SIZE_FIELD), &size, sizeof(size));
+    memcpy(record + offsetOf(SensorsEventFormatOffset::REPORT_TOKEN), &reportToken,
+           sizeof(reportToken));
+    memcpy(record + offsetOf(SensorsEventFormatOffset::SENSOR_TYPE), &type, sizeof(type));
+    memcpy(record + offsetOf(SensorsEventFormatOffset::TIMESTAMP), &event.timestamp,
+           sizeof(event.timestamp));
+    memcpy(record + offsetOf(SensorsEventFormatOffset::DATA), event.u.data, kDataSize);
+
+    counter->store(mCounter, std::memory_order_release);
+
+    // Zero marks a record that was never written
+    if (++mCounter == 0) mCounter = 1;
+    if (++mWriteIndex == mNumRecords) mWriteIndex = 0;
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/2.1/types.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+using ::android::hardware::sensors::V1_0::SharedMemInfo;
+using ::android::hardware::sensors::V2_1::Event;
+
+/*
+ * A client supplied shared memory region that events are written to in the
+ * sensors_event_t direct report layout, bypassing the multihal FMQ. Only
+ * ashmem backed channels are supported, gralloc buffers need a mapper.
+ *
+ * write() must only be called from one thread, the sub-HAL event loop.
+ */
+class DirectChannel {
+  public:
+    DirectChannel(int32_t handle, const SharedMemInfo& mem);
+    // Maps size bytes of a plain fd, e.g. a memfd
+    DirectChannel(int32_t handle, int fd, size_t size);
+    ~DirectChannel();
+
+    DirectChannel(const DirectChannel&) = delete;
+    DirectChannel& operator=(const DirectChannel&) = delete;
+
+    bool isValid() const { return mBase != nullptr; }
+    int32_t getHandle() const { return mHandle; }
+
+    void write(const Event& event, int32_t reportToken);
+
+    static bool isSupported(const SharedMemInfo& mem);
+
+  private:
+    void map(int fd, size_t size);
+
+    int32_t mHandle;
+    uint8_t* mBase;
+    size_t mSize;
+    size_t mNumRecords;
+    size_t mWriteIndex;
+    uint32_t mCounter;
+};
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
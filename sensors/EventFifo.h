@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/2.1/types.h>
+
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+using ::android::hardware::sensors::V2_1::Event;
+
+/*
+ * Fixed capacity ring of batched events. The storage is allocated once; push()
+ * refuses events once full so the owner can drain first.
+ */
+class EventFifo {
+  public:
+    explicit EventFifo(size_t capacity) : mEvents(capacity), mHead(0), mCount(0) {}
+
+    size_t capacity() const { return mEvents.size(); }
+    size_t size() const { return mCount; }
+    bool empty() const { return mCount == 0; }
+    bool full() const { return mCount == mEvents.size(); }
+
+    bool push(const Event& event) {
+        if (full()) return false;
+
+        mEvents[(mHead + mCount) % mEvents.size()] = event;
+        mCount++;
+        return true;
+    }
+
+    // Appends the events to out, oldest first, and empties the fifo
+    void drain(std::vector<Event>* out) {
+        for (size_t i = 0; i < mCount; i++) {
+            out->push_back(mEvents[(mHead + i) % mEvents.size()]);
+        }
+        mHead = 0;
+        mCount = 0;
+    }
+
+  private:
+    std::vector<Event> mEvents;
+    size_t mHead;
+    size_t mCount;
+};
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "EventLoop.h"
+
+#include <log/log.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <future>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+static constexpr int64_t kNsPerSec = 1000LL * 1000 * 1000;
+static constexpr int kMaxEvents = 8;
+
+EventLoop::EventLoop()
+    : mEpollFd(epoll_create1(EPOLL_CLOEXEC)),
+      mEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      mTimerFd(timerfd_create(CLOCK_BOOTTIME, TFD_CLOEXEC | TFD_NONBLOCK)) {
+    if (!mEpollFd.ok() || !mEventFd.ok() || !mTimerFd.ok()) {
+        ALOGE("failed to create event loop fds");
+        return;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN, .data = {.fd = mEventFd.get()}};
+    epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, mEventFd.get(), &ev);
+
+    ev = {.events = EPOLLIN, .data = {.fd = mTimerFd.get()}};
+    epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, mTimerFd.get(), &ev);
+
+    mThread = std::thread(&EventLoop::run, this);
+}
+
+EventLoop::~EventLoop() {
+    if (!mThread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mCommandMutex);
+        mStop = true;
+    }
+    wake();
+    mThread.join();
+}
+
+int64_t EventLoop::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return ts.tv_sec * kNsPerSec + ts.tv_nsec;
+}
+
+bool EventLoop::isLoopThread() const {
+    return std::this_thread::get_id() == mThread.get_id();
+}
+
+bool EventLoop::addFd(int fd, uint32_t events, FdHandler handler) {
+    struct epoll_event ev = {.events = events, .data = {.fd = fd}};
+
+    if (epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, fd, &ev) < 0) {
+        ALOGE("failed to watch fd %d: %d", fd, errno);
+        return false;
+    }
+
+    mFdHandlers[fd] = std::make_shared<FdHandler>(std::move(handler));
+    return true;
+}
+
+void EventLoop::removeFd(int fd) {
+    if (mFdHandlers.erase(fd) == 0) return;
+
+    epoll_ctl(mEpollFd.get(), EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int32_t EventLoop::createTimer(TimerHandler handler) {
+    int32_t id = mNextTimer++;
+    mTimers[id].handler = std::make_shared<TimerHandler>(std::move(handler));
+    // fireTimers() must not allocate, even when every timer is due at once
+    mDueTimers.reserve(mTimers.size());
+    return id;
+}
+
+void EventLoop::destroyTimer(int32_t timer) {
+    mTimers.erase(timer);
+    updateTimerFd();
+}
+
+void EventLoop::armTimer(int32_t timer, int64_t deadlineNs) {
+    auto it = mTimers.find(timer);
+    if (it == mTimers.end()) return;
+
+    it->second.deadlineNs = deadlineNs;
+    it->second.armed = true;
+    updateTimerFd();
+}
+
+void EventLoop::cancelTimer(int32_t timer) {
+    auto it = mTimers.find(timer);
+    if (it == mTimers.end() || !it->second.armed) return;
+
+    it->second.armed = false;
+    updateTimerFd();
+}
+
+/*
+ * All timers share the one timerfd, which is always armed for the earliest
+ * pending deadline.
+ */
+void EventLoop::updateTimerFd() {
+    int64_t earliest = 0;
+
+    for (const auto& [id, timer] : mTimers) {
+        if (timer.armed && (earliest == 0 || timer.deadlineNs < earliest)) {
+            earliest = timer.deadlineNs;
+        }
+    }
+
+    if (earliest == mArmedDeadlineNs) return;
+    mArmedDeadlineNs = earliest;
+
+    // A zero it_value disarms the timer, so clamp deadlines that are already due
+    int64_t deadline = earliest == 0 ? 0 : std::max<int64_t>(earliest, 1);
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = deadline / kNsPerSec;
+    spec.it_value.tv_nsec = deadline % kNsPerSec;
+
+    if (timerfd_settime(mTimerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        ALOGE("failed to arm timer: %d", errno);
+    }
+}
+
+void EventLoop::fireTimers() {
+    uint64_t expirations;
+    read(mTimerFd.get(), &expirations, sizeof(expirations));
+
+    mArmedDeadlineNs = 0;
+    int64_t now = EventLoop::now();
+
+    // Collect first, handlers are free to re-arm or destroy timers
+    mDueTimers.clear();
+    for (const auto& [id, timer] : mTimers) {
+        if (timer.armed && timer.deadlineNs <= now) mDueTimers.push_back(id);
+    }
+
+    for (int32_t id : mDueTimers) {
+        auto it = mTimers.find(id);
+        if (it == mTimers.end() || !it->second.armed) continue;
+
+        it->second.armed = false;
+        std::shared_ptr<TimerHandler> handler = it->second.handler;
+        (*handler)(it->second.deadlineNs);
+    }
+
+    updateTimerFd();
+}
+
+void EventLoop::setIdleHandler(Command handler) {
+    mIdleHandler = std::move(handler);
+}
+
+void EventLoop::post(Command cmd) {
+    {
+        std::lock_guard<std::mutex> lock(mCommandMutex);
+        if (!mDead) {
+            mCommands.push_back(std::move(cmd));
+            cmd = nullptr;
+        }
+    }
+
+    if (cmd) {
+        runInline(cmd);
+        return;
+    }
+    wake();
+}
+
+void EventLoop::runInline(const Command& cmd) {
+    std::lock_guard<std::recursive_mutex> lock(mInlineMutex);
+    cmd();
+}
+
+void EventLoop::runSync(const Command& cmd) {
+    if (isLoopThread() || !mThread.joinable()) {
+        cmd();
+        return;
+    }
+
+    std::promise<void> done;
+    post([&] {
+        cmd();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+void EventLoop::wake() {
+    uint64_t one = 1;
+    write(mEventFd.get(), &one, sizeof(one));
+}
+
+void EventLoop::drainCommands() {
+    uint64_t count;
+    read(mEventFd.get(), &count, sizeof(count));
+
+    for (;;) {
+        Command cmd;
+        {
+            std::lock_guard<std::mutex> lock(mCommandMutex);
+            if (mCommands.empty()) return;
+            cmd = std::move(mCommands.front());
+            mCommands.pop_front();
+        }
+        cmd();
+    }
+}
+
+void EventLoop::run() {
+    struct epoll_event events[kMaxEvents];
+
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mCommandMutex);
+            if (mStop) return;
+        }
+
+        int n = epoll_wait(mEpollFd.get(), events, kMaxEvents, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ALOGE("failed to epoll, running commands inline from now on: %d", errno);
+
+            // Hand over to the callers, or runSync() would wait forever
+            std::deque<Command> pending;
+            {
+                std::lock_guard<std::mutex> lock(mCommandMutex);
+                mDead = true;
+                pending.swap(mCommands);
+            }
+            for (const Command& cmd : pending) runInline(cmd);
+            return;
+        }
+        mWakeNs = now();
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == mEventFd.get()) {
+                drainCommands();
+            } else if (fd == mTimerFd.get()) {
+                fireTimers();
+            } else {
+                // The handler may have been removed by an earlier event in this batch
+                auto it = mFdHandlers.find(fd);
+                if (it != mFdHandlers.end()) {
+                    std::shared_ptr<FdHandler> handler = it->second;
+                    (*handler)(events[i].events);
+                }
+            }
+        }
+
+        if (mIdleHandler) mIdleHandler();
+    }
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+/*
+ * Single-threaded reactor shared by all sensors of the sub-HAL. Sensors watch
+ * their sysfs nodes with addFd() and arm deadlines on CLOCK_BOOTTIME instead
+ * of owning a thread each. Control requests from HAL threads are posted to
+ * the loop, so sensor state is only ever touched from the loop thread.
+ *
+ * addFd/removeFd and the timer functions must be called on the loop thread.
+ */
+class EventLoop {
+  public:
+    using FdHandler = std::function<void(uint32_t events)>;
+    using TimerHandler = std::function<void(int64_t deadlineNs)>;
+    using Command = std::function<void()>;
+
+    EventLoop();
+    ~EventLoop();
+
+    bool addFd(int fd, uint32_t events, FdHandler handler);
+    void removeFd(int fd);
+
+    int32_t createTimer(TimerHandler handler);
+    void destroyTimer(int32_t timer);
+    // deadlineNs is an absolute CLOCK_BOOTTIME timestamp
+    void armTimer(int32_t timer, int64_t deadlineNs);
+    void cancelTimer(int32_t timer);
+
+    // Runs cmd on the loop thread, either asynchronously or waiting for it.
+    // Once the loop has died on an epoll error, cmd runs inline instead.
+    void post(Command cmd);
+    void runSync(const Command& cmd);
+
+    // Runs handler at the end of every dispatch, before the loop blocks again
+    void setIdleHandler(Command handler);
+
+    bool isLoopThread() const;
+    // When epoll last returned, the start of the current dispatch
+    int64_t wakeTimeNs() const { return mWakeNs; }
+
+    static int64_t now();
+
+  private:
+    struct Timer {
+        // Shared so a handler can destroy its own timer while it runs
+        std::shared_ptr<TimerHandler> handler;
+        int64_t deadlineNs{0};
+        bool armed{false};
+    };
+
+    void run();
+    void wake();
+    void drainCommands();
+    void runInline(const Command& cmd);
+    void updateTimerFd();
+    void fireTimers();
+
+    ::android::base::unique_fd mEpollFd;
+    ::android::base::unique_fd mEventFd;
+    ::android::base::unique_fd mTimerFd;
+
+    std::unordered_map<int, std::shared_ptr<FdHandler>> mFdHandlers;
+    std::unordered_map<int32_t, Timer> mTimers;
+    std::vector<int32_t> mDueTimers;
+    int32_t mNextTimer{1};
+    int64_t mArmedDeadlineNs{0};
+    int64_t mWakeNs{0};
+    Command mIdleHandler;
+
+    std::mutex mCommandMutex;
+    std::deque<Command> mCommands;
+    bool mStop{false};
+    // Set when run() bailed out, nothing dispatches mCommands any more
+    bool mDead{false};
+    // Serializes inline commands, which may post or runSync themselves
+    std::recursive_mutex mInlineMutex;
+
+    std::thread mThread;
+};
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
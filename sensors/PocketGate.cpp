@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "PocketGate.h"
+
+#include <log/log.h>
+
+#include <chrono>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+using ::android::frameworks::sensorservice::V1_0::Result;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::sensors::V1_0::SensorFlagBits;
+using ::android::hardware::sensors::V1_0::SensorInfo;
+using ::android::hardware::sensors::V1_0::SensorType;
+
+// Brightest light that still counts as a pocket
+static constexpr float kPocketMaxLux = 5.0f;
+static constexpr int32_t kSamplingPeriodUs = 200 * 1000;
+// How long the sensors keep running after the gated sensor was disabled
+static constexpr auto kLinger = std::chrono::seconds(2);
+
+PocketGate::PocketGate() {
+    mThread = std::thread(&PocketGate::run, this);
+}
+
+PocketGate::~PocketGate() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mActive = false;
+        mExit = true;
+    }
+    mCv.notify_all();
+    mThread.join();
+}
+
+void PocketGate::setActive(bool active) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mActive = active;
+    }
+    mCv.notify_all();
+}
+
+bool PocketGate::isBlocked() {
+    if (!mHaveProximity || !mNear) return false;
+
+    // Proximity alone decides without a light sensor
+    if (mLightHandle < 0) return true;
+
+    float lux = mLux;
+    return lux >= 0 && lux <= kPocketMaxLux;
+}
+
+Return<void> PocketGate::Callback::onEvent(const ::android::hardware::sensors::V1_0::Event& event) {
+    if (event.sensorHandle == mGate->mProximityHandle) {
+        mGate->mNear = event.u.scalar < mGate->mProximityMaxRange;
+        mGate->mHaveProximity = true;
+    } else if (event.sensorHandle == mGate->mLightHandle) {
+        mGate->mLux = event.u.scalar;
+    }
+    return Void();
+}
+
+/*
+ * The sensor service is only talked to from here. It may call back into this
+ * HAL while handling a request, so doing this on the event loop, which the
+ * HAL entry points wait on, could deadlock.
+ */
+void PocketGate::run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    bool enabled = false;
+
+    while (!mExit) {
+        if (!enabled) {
+            mCv.wait(lock, [&] { return mExit || mActive; });
+        } else if (mActive) {
+            mCv.wait(lock, [&] { return mExit || !mActive; });
+            continue;
+        } else if (mCv.wait_for(lock, kLinger, [&] { return mExit || mActive; })) {
+            continue;
+        }
+        if (mExit) break;
+
+        enabled = mActive;
+        lock.unlock();
+        enableSensors(enabled);
+        lock.lock();
+    }
+
+    if (enabled) {
+        lock.unlock();
+        enableSensors(false);
+    }
+}
+
+bool PocketGate::connect() {
+    if (mQueue != nullptr) return true;
+
+    mManager = ISensorManager::getService();
+    if (mManager == nullptr) {
+        ALOGE("pocket gate: sensor manager unavailable");
+        return false;
+    }
+
+    if (!findSensors()) return false;
+
+    mManager->createEventQueue(new Callback(this), [&](const sp<IEventQueue>& queue,
+                                                        Result result) {
+        if (result == Result::OK) mQueue = queue;
+    });
+
+    return mQueue != nullptr;
+}
+
+/*
+ * getDefaultSensor() prefers the wake-up proximity sensor, which would wake
+ * the AP for every reading. The non-wake-up ones are all this needs.
+ */
+bool PocketGate::findSensors() {
+    mManager->getSensorList([&](const hidl_vec<SensorInfo>& list, Result result) {
+        if (result != Result::OK) return;
+
+        for (const SensorInfo& info : list) {
+            if (info.flags & static_cast<uint32_t>(SensorFlagBits::WAKE_UP)) continue;
+
+            if (info.type == SensorType::PROXIMITY && mProximityHandle < 0) {
+                mProximityHandle = info.sensorHandle;
+                mProximityMaxRange = info.maxRange;
+            } else if (info.type == SensorType::LIGHT && mLightHandle < 0) {
+                mLightHandle = info.sensorHandle;
+            }
+        }
+    });
+
+    if (mProximityHandle < 0) {
+        ALOGE("pocket gate: no non-wake-up proximity sensor");
+        return false;
+    }
+    return true;
+}
+
+void PocketGate::enableSensors(bool enable) {
+    // Stale readings must not gate the next activation
+    mHaveProximity = false;
+    mLux = -1;
+
+    if (!enable) {
+        if (mQueue == nullptr) return;
+
+        mQueue->disableSensor(mProximityHandle);
+        if (mLightHandle >= 0) mQueue->disableSensor(mLightHandle);
+        return;
+    }
+
+    if (!connect()) return;
+
+    mQueue->enableSensor(mProximityHandle, kSamplingPeriodUs, 0 /* maxBatchReportLatencyUs */);
+    if (mLightHandle >= 0) {
+        mQueue->enableSensor(mLightHandle, kSamplingPeriodUs, 0 /* maxBatchReportLatencyUs */);
+    }
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
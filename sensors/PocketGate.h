@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/frameworks/sensorservice/1.0/IEventQueue.h>
+#include <android/frameworks/sensorservice/1.0/IEventQueueCallback.h>
+#include <android/frameworks/sensorservice/1.0/ISensorManager.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Sensor.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+using ::android::frameworks::sensorservice::V1_0::IEventQueue;
+using ::android::frameworks::sensorservice::V1_0::IEventQueueCallback;
+using ::android::frameworks::sensorservice::V1_0::ISensorManager;
+
+/*
+ * Blocks events while the proximity sensor reads near and the ambient light,
+ * if there is a light sensor, is dark, i.e. the phone is in a pocket.
+ * Both sensors come from the other sub-HALs through the sensor service. Only
+ * their non-wake-up variants are used, and they run for as long as the gated
+ * sensor is enabled, which the framework only does while the screen is off.
+ * A short linger covers the one-shot sensor disabling itself after every
+ * report until it is enabled again.
+ *
+ * Everything fails open: without the service, without non-wake-up sensors,
+ * before the first proximity reading or while the light level is unknown,
+ * no event is ever blocked.
+ */
+class PocketGate : public EventGate {
+  public:
+    PocketGate();
+    ~PocketGate() override;
+
+    void setActive(bool active) override;
+    bool isBlocked() override;
+
+  private:
+    class Callback : public IEventQueueCallback {
+      public:
+        explicit Callback(PocketGate* gate) : mGate(gate) {}
+        Return<void> onEvent(const ::android::hardware::sensors::V1_0::Event& event) override;
+
+      private:
+        PocketGate* mGate;
+    };
+
+    void run();
+    bool connect();
+    bool findSensors();
+    void enableSensors(bool enable);
+
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    bool mActive{false};
+    bool mExit{false};
+
+    // Only used on the worker thread, sensor service calls may block
+    sp<ISensorManager> mManager;
+    sp<IEventQueue> mQueue;
+    // Set before the queue exists, so readable once a proximity reading arrived
+    int32_t mProximityHandle{-1};
+    int32_t mLightHandle{-1};
+    float mProximityMaxRange{0};
+
+    std::atomic<bool> mHaveProximity{false};
+    std::atomic<bool> mNear{false};
+    // Negative while unknown
+    std::atomic<float> mLux{-1};
+
+    std::thread mThread;
+};
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -18,30 +18,10 @@
 
 #include <hardware/sensors.h>
 #include <log/log.h>
-#include <utils/SystemClock.h>
 
+#include <algorithm>
 #include <cmath>
-
-static bool readBool(int fd, bool seek) {
-    char c;
-    int rc;
-
-    if (seek) {
-        rc = lseek(fd, 0, SEEK_SET);
-        if (rc) {
-            ALOGE("failed to seek: %d", rc);
-            return false;
-        }
-    }
-
-    rc = read(fd, &c, sizeof(c));
-    if (rc != 1) {
-        ALOGE("failed to read bool: %d", rc);
-        return false;
-    }
-
-    return c != '0';
-}
+#include <iterator>
 
 namespace android {
 namespace hardware {
@@ -52,139 +32,255 @@ namespace implementation {
 
 using ::android::hardware::sensors::V1_0::MetaDataEventType;
 using ::android::hardware::sensors::V1_0::OperationMode;
+using ::android::hardware::sensors::V1_0::RateLevel;
 using ::android::hardware::sensors::V1_0::Result;
 using ::android::hardware::sensors::V1_0::SensorFlagBits;
+using ::android::hardware::sensors::V1_0::SensorFlagShift;
 using ::android::hardware::sensors::V1_0::SensorStatus;
 using ::android::hardware::sensors::V2_1::Event;
 using ::android::hardware::sensors::V2_1::SensorInfo;
 using ::android::hardware::sensors::V2_1::SensorType;
 
-Sensor::Sensor(int32_t sensorHandle, ISensorsEventCallback* callback)
+// Periods a sampling timer may lag behind before deadlines are dropped
+static constexpr int64_t kMaxCatchUpSamples = 4;
+
+// Nominal rates of RateLevel NORMAL, FAST and VERY_FAST: 50, 200 and 800 Hz
+static constexpr int64_t kDirectReportPeriodNs[] = {0, 20000000, 5000000, 1250000};
+
+Sensor::Sensor(int32_t sensorHandle, ISensorsEventCallback* callback, EventLoop* loop,
+               size_t fifoCapacity)
     : mIsEnabled(false),
       mSamplingPeriodNs(0),
+      mMaxReportLatencyNs(0),
       mLastSampleTimeNs(0),
       mCallback(callback),
-      mMode(OperationMode::NORMAL) {
+      mLoop(loop),
+      mMode(OperationMode::NORMAL),
+      mTimer(0),
+      mFifo(fifoCapacity),
+      mBatchTimer(0) {
     mSensorInfo.sensorHandle = sensorHandle;
     mSensorInfo.vendor = "The LineageOS Project";
     mSensorInfo.version = 1;
     constexpr float kDefaultMaxDelayUs = 1000 * 1000;
     mSensorInfo.maxDelay = kDefaultMaxDelayUs;
-    mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    // The fifo is private to the sensor, so all of it is reserved
+    mSensorInfo.fifoReservedEventCount = fifoCapacity;
+    mSensorInfo.fifoMaxEventCount = fifoCapacity;
     mSensorInfo.requiredPermission = "";
     mSensorInfo.flags = 0;
-    mRunThread = std::thread(startThread, this);
+
+    mReadBuffer.reserve(kMaxEventsPerRead);
+    // Holds a drained fifo, or a single flush complete or injected event
+    mPostBuffer.reserve(std::max<size_t>(fifoCapacity, 1));
 }
 
 Sensor::~Sensor() {
-    // Ensure that lock is unlocked before calling mRunThread.join() or a
-    // deadlock will occur.
-    {
-        std::unique_lock<std::mutex> lock(mRunMutex);
-        mStopThread = true;
-        mIsEnabled = false;
-        mWaitCV.notify_all();
-    }
-    mRunThread.join();
+    // Once this returns the loop can no longer call into the sensor
+    mLoop->runSync([this] {
+        if (mTimer != 0) mLoop->destroyTimer(mTimer);
+        if (mBatchTimer != 0) mLoop->destroyTimer(mBatchTimer);
+        for (const auto& [handle, report] : mDirectReports) mLoop->destroyTimer(report.timer);
+    });
 }
 
 const SensorInfo& Sensor::getSensorInfo() const {
     return mSensorInfo;
 }
 
-void Sensor::batch(int32_t samplingPeriodNs) {
+void Sensor::batch(int32_t samplingPeriodNs, int64_t maxReportLatencyNs) {
     samplingPeriodNs =
         std::clamp(samplingPeriodNs, mSensorInfo.minDelay * 1000, mSensorInfo.maxDelay * 1000);
 
-    if (mSamplingPeriodNs != samplingPeriodNs) {
-        mSamplingPeriodNs = samplingPeriodNs;
-        // Wake up the 'run' thread to check if a new event should be generated now
-        mWaitCV.notify_all();
-    }
+    mLoop->runSync([&] {
+        // Events batched under the old latency must not outlive the new one
+        if (mMaxReportLatencyNs != maxReportLatencyNs) {
+            drainFifo();
+            mMaxReportLatencyNs = maxReportLatencyNs;
+        }
+
+        if (mSamplingPeriodNs != samplingPeriodNs) {
+            mSamplingPeriodNs = samplingPeriodNs;
+            // Check if a new event should be generated now
+            reschedule();
+        }
+    });
 }
 
 void Sensor::activate(bool enable) {
-    std::lock_guard<std::mutex> lock(mRunMutex);
-    if (mIsEnabled != enable) {
-        mIsEnabled = enable;
-        mWaitCV.notify_all();
-    }
+    mLoop->runSync([&] {
+        if (mIsEnabled != enable) {
+            mIsEnabled = enable;
+            reschedule();
+        }
+    });
 }
 
 Result Sensor::flush() {
-    // Only generate a flush complete event if the sensor is enabled and if the sensor is not a
-    // one-shot sensor.
-    if (!mIsEnabled) {
-        return Result::BAD_VALUE;
+    Result result = Result::OK;
+
+    mLoop->runSync([&] {
+        // Only generate a flush complete event if the sensor is enabled and if the sensor is not a
+        // one-shot sensor.
+        if (!mIsEnabled) {
+            result = Result::BAD_VALUE;
+            return;
+        }
+
+        // Write all of the currently batched events for the sensor to the Event FMQ prior to
+        // writing the flush complete event.
+        drainFifo();
+
+        Event ev;
+        ev.sensorHandle = mSensorInfo.sensorHandle;
+        ev.sensorType = SensorType::META_DATA;
+        ev.u.meta.what = MetaDataEventType::META_DATA_FLUSH_COMPLETE;
+        mPostBuffer.clear();
+        mPostBuffer.push_back(ev);
+        post(mPostBuffer);
+        mStats.flushes++;
+    });
+
+    return result;
+}
+
+/*
+ * Arms the sampling timer for the next sample while the sensor is polling.
+ * A sample that is already overdue, e.g. right after enabling, fires at once.
+ */
+void Sensor::reschedule() {
+    if (!isPolling()) {
+        if (mTimer != 0) mLoop->cancelTimer(mTimer);
+        drainFifo();
+        return;
     }
 
-    // Note: If a sensor supports batching, write all of the currently batched events for the sensor
-    // to the Event FMQ prior to writing the flush complete event.
-    Event ev;
-    ev.sensorHandle = mSensorInfo.sensorHandle;
-    ev.sensorType = SensorType::META_DATA;
-    ev.u.meta.what = MetaDataEventType::META_DATA_FLUSH_COMPLETE;
-    std::vector<Event> evs{ev};
-    mCallback->postEvents(evs, isWakeUpSensor());
+    if (mTimer == 0) {
+        mTimer = mLoop->createTimer([this](int64_t deadlineNs) { onSampleTimer(deadlineNs); });
+    }
 
-    return Result::OK;
+    mLoop->armTimer(mTimer, std::max(mLastSampleTimeNs + mSamplingPeriodNs, EventLoop::now()));
 }
 
-void Sensor::startThread(Sensor* sensor) {
-    sensor->run();
+/*
+ * Samples are stamped with the deadline they were scheduled for and the next
+ * deadline is derived from it rather than from the wakeup, so late wakeups
+ * show up as jitter but never accumulate into drift.
+ */
+void Sensor::onSampleTimer(int64_t deadlineNs) {
+    mStats.recordJitter(mLoop->wakeTimeNs() - deadlineNs);
+
+    mLastSampleTimeNs = deadlineNs;
+    report(sample(deadlineNs));
+    mLoop->armTimer(mTimer, nextDeadline(deadlineNs, mSamplingPeriodNs));
 }
 
-void Sensor::run() {
-    std::unique_lock<std::mutex> runLock(mRunMutex);
-    constexpr int64_t kNanosecondsInSeconds = 1000 * 1000 * 1000;
+/*
+ * A late sample is followed by the next one on schedule. Only when the loop
+ * fell far behind, e.g. after suspend, are the missed deadlines dropped
+ * instead of being sampled in a burst.
+ */
+int64_t Sensor::nextDeadline(int64_t deadlineNs, int64_t periodNs) {
+    int64_t now = EventLoop::now();
+    int64_t next = deadlineNs + periodNs;
+
+    if (periodNs > 0 && now - next > kMaxCatchUpSamples * periodNs) {
+        int64_t missed = (now - deadlineNs) / periodNs;
+        mStats.missedSamples += missed;
+        next = deadlineNs + (missed + 1) * periodNs;
+    }
 
-    while (!mStopThread) {
-        if (!mIsEnabled || mMode == OperationMode::DATA_INJECTION) {
-            mWaitCV.wait(runLock, [&] {
-                return ((mIsEnabled && mMode == OperationMode::NORMAL) || mStopThread);
-            });
-        } else {
-            timespec curTime;
-            clock_gettime(CLOCK_REALTIME, &curTime);
-            int64_t now = (curTime.tv_sec * kNanosecondsInSeconds) + curTime.tv_nsec;
-            int64_t nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
-
-            if (now >= nextSampleTime) {
-                mLastSampleTimeNs = now;
-                nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
-                mCallback->postEvents(readEvents(), isWakeUpSensor());
-            }
+    return next;
+}
+
+/*
+ * With a report latency the events wait in the fifo until the first of them
+ * is maxReportLatencyNs old or the fifo fills up, and then go out in a single
+ * postEvents() call.
+ */
+void Sensor::report(const std::vector<Event>& events) {
+    if (mMaxReportLatencyNs == 0 || mFifo.capacity() == 0) {
+        post(events);
+        return;
+    }
 
-            mWaitCV.wait_for(runLock, std::chrono::nanoseconds(nextSampleTime - now));
+    bool wasEmpty = mFifo.empty();
+    for (const Event& event : events) {
+        if (!mFifo.push(event)) {
+            drainFifo();
+            mFifo.push(event);
         }
     }
+
+    if (mFifo.full()) {
+        drainFifo();
+    } else if (wasEmpty && !mFifo.empty()) {
+        if (mBatchTimer == 0) {
+            mBatchTimer = mLoop->createTimer([this](int64_t /* deadlineNs */) { drainFifo(); });
+        }
+        mLoop->armTimer(mBatchTimer, EventLoop::now() + mMaxReportLatencyNs);
+    }
+}
+
+void Sensor::drainFifo() {
+    if (mFifo.empty()) return;
+
+    if (mBatchTimer != 0) mLoop->cancelTimer(mBatchTimer);
+
+    mPostBuffer.clear();
+    mFifo.drain(&mPostBuffer);
+    post(mPostBuffer);
+}
+
+void Sensor::post(const std::vector<Event>& events) {
+    bool wakeup = isWakeUpSensor();
+
+    mCallback->postEvents(events, wakeup);
+
+    mStats.events += events.size();
+    if (wakeup) mStats.wakeups++;
+    mStats.recordLatency(EventLoop::now() - mLoop->wakeTimeNs());
+}
+
+SensorStats Sensor::getStats() {
+    SensorStats stats;
+    mLoop->runSync([&] { stats = mStats; });
+    return stats;
+}
+
+void Sensor::resetStats() {
+    mLoop->runSync([&] { mStats.reset(); });
+}
+
+const std::vector<Event>& Sensor::sample(int64_t timestampNs) {
+    mReadBuffer.clear();
+    readEvents(timestampNs, &mReadBuffer);
+    return mReadBuffer;
 }
 
 bool Sensor::isWakeUpSensor() {
     return mSensorInfo.flags & static_cast<uint32_t>(SensorFlagBits::WAKE_UP);
 }
 
-std::vector<Event> Sensor::readEvents() {
-    std::vector<Event> events;
+void Sensor::readEvents(int64_t timestampNs, std::vector<Event>* events) {
     Event event;
     event.sensorHandle = mSensorInfo.sensorHandle;
     event.sensorType = mSensorInfo.type;
-    event.timestamp = ::android::elapsedRealtimeNano();
+    event.timestamp = timestampNs;
     event.u.vec3.x = 0;
     event.u.vec3.y = 0;
     event.u.vec3.z = 0;
     event.u.vec3.status = SensorStatus::ACCURACY_HIGH;
-    events.push_back(event);
-    return events;
+    events->push_back(event);
 }
 
 void Sensor::setOperationMode(OperationMode mode) {
-    std::lock_guard<std::mutex> lock(mRunMutex);
-    if (mMode != mode) {
-        mMode = mode;
-        mWaitCV.notify_all();
-    }
+    mLoop->runSync([&] {
+        if (mMode != mode) {
+            mMode = mode;
+            reschedule();
+        }
+    });
 }
 
 bool Sensor::supportsDataInjection() const {
@@ -193,148 +289,167 @@ bool Sensor::supportsDataInjection() const {
 
 Result Sensor::injectEvent(const Event& event) {
     Result result = Result::OK;
-    if (event.sensorType == SensorType::ADDITIONAL_INFO) {
-        // When in OperationMode::NORMAL, SensorType::ADDITIONAL_INFO is used to push operation
-        // environment data into the device.
-    } else if (!supportsDataInjection()) {
-        result = Result::INVALID_OPERATION;
-    } else if (mMode == OperationMode::DATA_INJECTION) {
-        mCallback->postEvents(std::vector<Event>{event}, isWakeUpSensor());
-    } else {
-        result = Result::BAD_VALUE;
-    }
+
+    mLoop->runSync([&] {
+        if (event.sensorType == SensorType::ADDITIONAL_INFO) {
+            // When in OperationMode::NORMAL, SensorType::ADDITIONAL_INFO is used to push operation
+            // environment data into the device.
+        } else if (!supportsDataInjection()) {
+            result = Result::INVALID_OPERATION;
+        } else if (mMode == OperationMode::DATA_INJECTION) {
+            mPostBuffer.clear();
+            mPostBuffer.push_back(event);
+            post(mPostBuffer);
+        } else {
+            result = Result::BAD_VALUE;
+        }
+    });
+
     return result;
 }
 
-OneShotSensor::OneShotSensor(int32_t sensorHandle, ISensorsEventCallback* callback)
-    : Sensor(sensorHandle, callback) {
-    mSensorInfo.minDelay = -1;
-    mSensorInfo.maxDelay = 0;
-    mSensorInfo.flags |= SensorFlagBits::ONE_SHOT_MODE;
+bool Sensor::supportsDirectReport() const {
+    return mSensorInfo.flags & static_cast<uint32_t>(SensorFlagBits::DIRECT_CHANNEL_ASHMEM);
 }
 
-SysfsPollingOneShotSensor::SysfsPollingOneShotSensor(
-    int32_t sensorHandle, ISensorsEventCallback* callback, const std::string& pollPath,
-    const std::string& name, const std::string& typeAsString, SensorType type)
-    : OneShotSensor(sensorHandle, callback) {
-    mSensorInfo.name = name;
-    mSensorInfo.type = type;
-    mSensorInfo.typeAsString = typeAsString;
-    mSensorInfo.maxRange = 2048.0f;
-    mSensorInfo.resolution = 1.0f;
-    mSensorInfo.power = 0;
-    mSensorInfo.flags |= SensorFlagBits::WAKE_UP;
-
-    int rc;
-
-    rc = pipe(mWaitPipeFd);
-    if (rc < 0) {
-        mWaitPipeFd[0] = -1;
-        mWaitPipeFd[1] = -1;
-        ALOGE("failed to open wait pipe: %d", rc);
-    }
+void Sensor::setDirectReportRateLevel(RateLevel maxRate) {
+    mSensorInfo.flags &= ~static_cast<uint32_t>(SensorFlagBits::MASK_DIRECT_REPORT);
+    mSensorInfo.flags |= static_cast<uint32_t>(maxRate)
+                         << static_cast<uint8_t>(SensorFlagShift::DIRECT_REPORT);
+    mSensorInfo.flags |= SensorFlagBits::DIRECT_CHANNEL_ASHMEM;
+}
 
-    mPollFd = open(pollPath.c_str(), O_RDONLY);
-    if (mPollFd < 0) {
-        ALOGE("failed to open poll fd: %d", mPollFd);
+/*
+ * Direct reports are independent of activate() and batch(): every configured
+ * channel gets its own timer running at the nominal rate of its level.
+ */
+Result Sensor::configDirectReport(const std::shared_ptr<DirectChannel>& channel, RateLevel rate,
+                                  int32_t* reportToken) {
+    uint32_t maxRate = (mSensorInfo.flags & static_cast<uint32_t>(SensorFlagBits::MASK_DIRECT_REPORT))
+                       >> static_cast<uint8_t>(SensorFlagShift::DIRECT_REPORT);
+
+    *reportToken = 0;
+    if (!supportsDirectReport()) {
+        return Result::INVALID_OPERATION;
     }
-
-    if (mWaitPipeFd[0] < 0 || mWaitPipeFd[1] < 0 || mPollFd < 0) {
-        mStopThread = true;
-        return;
+    if (static_cast<uint32_t>(rate) > maxRate) {
+        return Result::BAD_VALUE;
     }
 
-    mPolls[0] = {
-        .fd = mWaitPipeFd[0],
-        .events = POLLIN,
-    };
+    mLoop->runSync([&] {
+        int32_t channelHandle = channel->getHandle();
+        auto it = mDirectReports.find(channelHandle);
 
-    mPolls[1] = {
-        .fd = mPollFd,
-        .events = POLLERR | POLLPRI,
-    };
-}
+        if (rate == RateLevel::STOP) {
+            if (it != mDirectReports.end()) {
+                mLoop->destroyTimer(it->second.timer);
+                mDirectReports.erase(it);
+            }
+            return;
+        }
 
-SysfsPollingOneShotSensor::~SysfsPollingOneShotSensor() {
-    interruptPoll();
+        if (it == mDirectReports.end()) {
+            int32_t timer = mLoop->createTimer([this, channelHandle](int64_t deadlineNs) {
+                onDirectReportTimer(channelHandle, deadlineNs);
+            });
+            it = mDirectReports.emplace(channelHandle, DirectReport{channel, timer, 0}).first;
+        }
+
+        it->second.periodNs = std::max<int64_t>(kDirectReportPeriodNs[static_cast<size_t>(rate)],
+                                                mSensorInfo.minDelay * 1000LL);
+        mLoop->armTimer(it->second.timer, EventLoop::now() + it->second.periodNs);
+        // The framework tells sensors apart by the token, the handle is unique
+        *reportToken = mSensorInfo.sensorHandle;
+    });
+
+    return Result::OK;
 }
 
-void SysfsPollingOneShotSensor::activate(bool enable, bool notify, bool lock) {
-    std::unique_lock<std::mutex> runLock(mRunMutex, std::defer_lock);
+void Sensor::onDirectReportTimer(int32_t channelHandle, int64_t deadlineNs) {
+    auto it = mDirectReports.find(channelHandle);
+    if (it == mDirectReports.end()) return;
 
-    if (lock) {
-        runLock.lock();
+    for (const Event& event : sample(deadlineNs)) {
+        it->second.channel->write(event, mSensorInfo.sensorHandle);
     }
+    mLoop->armTimer(it->second.timer, nextDeadline(deadlineNs, it->second.periodNs));
+}
 
-    if (mIsEnabled != enable) {
-        mIsEnabled = enable;
+OneShotSensor::OneShotSensor(int32_t sensorHandle, ISensorsEventCallback* callback,
+                             EventLoop* loop)
+    // One-shot events are never batched
+    : Sensor(sensorHandle, callback, loop, 0 /* fifoCapacity */) {
+    mSensorInfo.minDelay = -1;
+    mSensorInfo.maxDelay = 0;
+    mSensorInfo.flags |= SensorFlagBits::ONE_SHOT_MODE;
+}
 
-        if (notify) {
-            interruptPoll();
-            mWaitCV.notify_all();
-        }
+static void applyDescriptor(const SensorDescriptor& desc, SensorInfo* info) {
+    info->name = desc.name;
+    info->type = desc.type;
+    info->typeAsString = desc.typeAsString;
+    info->maxRange = 2048.0f;
+    info->resolution = 1.0f;
+    info->power = 0;
+    if (desc.wakeUp) {
+        info->flags |= SensorFlagBits::WAKE_UP;
     }
+}
 
-    if (lock) {
-        runLock.unlock();
-    }
+SysfsPollingOneShotSensor::SysfsPollingOneShotSensor(int32_t sensorHandle,
+                                                     ISensorsEventCallback* callback,
+                                                     EventLoop* loop, const SensorDescriptor& desc,
+                                                     std::unique_ptr<SensorNode> node)
+    : OneShotSensor(sensorHandle, callback, loop), mNode(std::move(node)), mParser(desc.parser) {
+    applyDescriptor(desc, &mSensorInfo);
 }
 
-void SysfsPollingOneShotSensor::activate(bool enable) {
-    activate(enable, true, true);
+SysfsPollingOneShotSensor::~SysfsPollingOneShotSensor() {
+    mLoop->runSync([this] { mNode->watch(mLoop, false, nullptr); });
 }
 
-void SysfsPollingOneShotSensor::setOperationMode(OperationMode mode) {
-    Sensor::setOperationMode(mode);
-    interruptPoll();
+/*
+ * The node is only watched while the sensor is enabled in normal mode, so an
+ * idle sensor costs nothing but its open fd.
+ */
+void SysfsPollingOneShotSensor::reschedule() {
+    mNode->watch(mLoop, isPolling(), [this](uint32_t events) { onPollEvent(events); });
+    if (mGate != nullptr) mGate->setActive(isPolling());
 }
 
-void SysfsPollingOneShotSensor::run() {
-    std::unique_lock<std::mutex> runLock(mRunMutex);
+void SysfsPollingOneShotSensor::onPollEvent(uint32_t events) {
+    float values[kMaxSensorValues]{};
 
-    while (!mStopThread) {
-        if (!mIsEnabled || mMode == OperationMode::DATA_INJECTION) {
-            mWaitCV.wait(runLock, [&] {
-                return ((mIsEnabled && mMode == OperationMode::NORMAL) || mStopThread);
-            });
-        } else {
-            // Cannot hold lock while polling.
-            runLock.unlock();
-            int rc = poll(mPolls, 2, -1);
-            runLock.lock();
-
-            if (rc < 0) {
-                ALOGE("failed to poll: %d", rc);
-                mStopThread = true;
-                continue;
-            }
+    if (!mNode->isNotification(events) || !mNode->readValue(mParser, values)) {
+        mStats.spuriousPolls++;
+        return;
+    }
 
-            if (mPolls[1].revents == mPolls[1].events && readBool(mPollFd, true /* seek */)) {
-                activate(false, false, false);
-                mCallback->postEvents(readEvents(), isWakeUpSensor());
-            } else if (mPolls[0].revents == mPolls[0].events) {
-                readBool(mWaitPipeFd[0], false /* seek */);
-            }
-        }
+    if (values[0] == 0) {
+        mStats.spuriousPolls++;
+        return;
     }
-}
 
-void SysfsPollingOneShotSensor::interruptPoll() {
-    if (mWaitPipeFd[1] < 0) return;
+    // A gated event leaves the sensor armed for the next one
+    if (mGate != nullptr && mGate->isBlocked()) {
+        mStats.gatedEvents++;
+        return;
+    }
 
-    char c = '1';
-    write(mWaitPipeFd[1], &c, sizeof(c));
+    // One-shot sensors disable themselves after reporting
+    mIsEnabled = false;
+    reschedule();
+    // Stamped with when the notification woke the loop up
+    report(sample(mLoop->wakeTimeNs()));
 }
 
-std::vector<Event> SysfsPollingOneShotSensor::readEvents() {
-    std::vector<Event> events;
+void SysfsPollingOneShotSensor::readEvents(int64_t timestampNs, std::vector<Event>* events) {
     Event event;
     event.sensorHandle = mSensorInfo.sensorHandle;
     event.sensorType = mSensorInfo.type;
-    event.timestamp = ::android::elapsedRealtimeNano();
+    event.timestamp = timestampNs;
     fillEventData(event);
-    events.push_back(event);
-    return events;
+    events->push_back(event);
 }
 
 void SysfsPollingOneShotSensor::fillEventData(Event& event) {
@@ -342,6 +457,83 @@ void SysfsPollingOneShotSensor::fillEventData(Event& event) {
     event.u.data[1] = 0;
 }
 
+SysfsOnChangeSensor::SysfsOnChangeSensor(int32_t sensorHandle, ISensorsEventCallback* callback,
+                                         EventLoop* loop, const SensorDescriptor& desc,
+                                         std::unique_ptr<SensorNode> node)
+    : Sensor(sensorHandle, callback, loop),
+      mNode(std::move(node)),
+      mParser(desc.parser),
+      mValues() {
+    applyDescriptor(desc, &mSensorInfo);
+    mSensorInfo.minDelay = 0;
+    mSensorInfo.maxDelay = 0;
+    mSensorInfo.flags |= SensorFlagBits::ON_CHANGE_MODE;
+}
+
+SysfsOnChangeSensor::~SysfsOnChangeSensor() {
+    mLoop->runSync([this] { mNode->watch(mLoop, false, nullptr); });
+}
+
+/*
+ * On-change sensors report their current value as soon as they are enabled,
+ * then again on every notification that changed it.
+ */
+void SysfsOnChangeSensor::reschedule() {
+    bool polling = isPolling();
+
+    if (polling && !mNode->watching()) {
+        mNode->watch(mLoop, true, [this](uint32_t events) { onPollEvent(events); });
+        if (mNode->readValue(mParser, mValues)) report(sample(EventLoop::now()));
+    } else if (!polling && mNode->watching()) {
+        mNode->watch(mLoop, false, nullptr);
+        drainFifo();
+    }
+}
+
+void SysfsOnChangeSensor::onPollEvent(uint32_t events) {
+    float values[kMaxSensorValues]{};
+
+    if (!mNode->isNotification(events) || !mNode->readValue(mParser, values) ||
+        std::equal(values, values + kMaxSensorValues, mValues)) {
+        mStats.spuriousPolls++;
+        return;
+    }
+
+    std::copy(values, values + kMaxSensorValues, mValues);
+    report(sample(mLoop->wakeTimeNs()));
+}
+
+void SysfsOnChangeSensor::readEvents(int64_t timestampNs, std::vector<Event>* events) {
+    Event event;
+    event.sensorHandle = mSensorInfo.sensorHandle;
+    event.sensorType = mSensorInfo.type;
+    event.timestamp = timestampNs;
+    std::fill(std::begin(event.u.data), std::end(event.u.data), 0.0f);
+    std::copy(mValues, mValues + kMaxSensorValues, event.u.data);
+    events->push_back(event);
+}
+
+SysfsPeriodicSensor::SysfsPeriodicSensor(int32_t sensorHandle, ISensorsEventCallback* callback,
+                                         EventLoop* loop, const SensorDescriptor& desc,
+                                         std::unique_ptr<SensorNode> node)
+    : Sensor(sensorHandle, callback, loop), mNode(std::move(node)), mParser(desc.parser) {
+    applyDescriptor(desc, &mSensorInfo);
+    // Node reads are cheap but not free, 100 Hz is plenty for these nodes
+    mSensorInfo.minDelay = 10 * 1000;
+    setDirectReportRateLevel(RateLevel::NORMAL);
+}
+
+void SysfsPeriodicSensor::readEvents(int64_t timestampNs, std::vector<Event>* events) {
+    Event event;
+    event.sensorHandle = mSensorInfo.sensorHandle;
+    event.sensorType = mSensorInfo.type;
+    event.timestamp = timestampNs;
+    std::fill(std::begin(event.u.data), std::end(event.u.data), 0.0f);
+
+    // A failed read skips the sample instead of reporting stale data
+    if (mNode->readValue(mParser, event.u.data)) events->push_back(event);
+}
+
 }  // namespace implementation
 }  // namespace subhal
 }  // namespace V2_1
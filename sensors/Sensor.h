@@ -17,17 +17,20 @@
 #pragma once
 
 #include <android/hardware/sensors/2.1/types.h>
-#include <fcntl.h>
-#include <poll.h>
-#include <unistd.h>
 
-#include <condition_variable>
+#include <map>
 #include <memory>
-#include <mutex>
-#include <thread>
 #include <vector>
 
+#include "DirectChannel.h"
+#include "EventFifo.h"
+#include "EventLoop.h"
+#include "SensorConfig.h"
+#include "SensorNode.h"
+#include "SensorStats.h"
+
 using ::android::hardware::sensors::V1_0::OperationMode;
+using ::android::hardware::sensors::V1_0::RateLevel;
 using ::android::hardware::sensors::V1_0::Result;
 using ::android::hardware::sensors::V2_1::Event;
 using ::android::hardware::sensors::V2_1::SensorInfo;
@@ -46,13 +49,24 @@ class ISensorsEventCallback {
     virtual void postEvents(const std::vector<Event>& events, bool wakeup) = 0;
 };
 
+// Events a continuous sensor can batch in software
+constexpr size_t kSensorFifoCapacity = 128;
+// Room readEvents() gets per sample
+constexpr size_t kMaxEventsPerRead = 4;
+
+/*
+ * Sensors do not own threads. All of their state lives on the sub-HAL event
+ * loop; the public entry points run synchronously on it and every state change
+ * ends in reschedule(), which (re)registers whatever the sensor waits on.
+ */
 class Sensor {
   public:
-    Sensor(int32_t sensorHandle, ISensorsEventCallback* callback);
+    Sensor(int32_t sensorHandle, ISensorsEventCallback* callback, EventLoop* loop,
+           size_t fifoCapacity = kSensorFifoCapacity);
     virtual ~Sensor();
 
     const SensorInfo& getSensorInfo() const;
-    virtual void batch(int32_t samplingPeriodNs);
+    virtual void batch(int32_t samplingPeriodNs, int64_t maxReportLatencyNs);
     virtual void activate(bool enable);
     virtual Result flush();
 
@@ -60,33 +74,86 @@ class Sensor {
     bool supportsDataInjection() const;
     Result injectEvent(const Event& event);
 
+    SensorStats getStats();
+    void resetStats();
+
+    bool supportsDirectReport() const;
+    // Starts, retunes or (with RateLevel::STOP) stops reporting into channel
+    Result configDirectReport(const std::shared_ptr<DirectChannel>& channel, RateLevel rate,
+                              int32_t* reportToken);
+
   protected:
-    virtual void run();
-    virtual std::vector<Event> readEvents();
-    static void startThread(Sensor* sensor);
+    virtual void reschedule();
+    // Appends at most kMaxEventsPerRead events taken at timestampNs to the buffer
+    virtual void readEvents(int64_t timestampNs, std::vector<Event>* events);
+    // Samples the sensor into the read buffer, which is reused for every read
+    const std::vector<Event>& sample(int64_t timestampNs);
+    // Posts events now or batches them within the report latency
+    void report(const std::vector<Event>& events);
+    void drainFifo();
+    // Hands events to the callback and accounts for them
+    void post(const std::vector<Event>& events);
 
     bool isWakeUpSensor();
+    bool isPolling() const { return mIsEnabled && mMode == OperationMode::NORMAL; }
+    // For continuous sensors only, called from the constructor
+    void setDirectReportRateLevel(RateLevel maxRate);
 
     bool mIsEnabled;
     int64_t mSamplingPeriodNs;
+    int64_t mMaxReportLatencyNs;
     int64_t mLastSampleTimeNs;
     SensorInfo mSensorInfo;
 
-    std::atomic_bool mStopThread;
-    std::condition_variable mWaitCV;
-    std::mutex mRunMutex;
-    std::thread mRunThread;
-
     ISensorsEventCallback* mCallback;
+    EventLoop* mLoop;
 
     OperationMode mMode;
+
+    SensorStats mStats;
+
+  private:
+    struct DirectReport {
+        std::shared_ptr<DirectChannel> channel;
+        int32_t timer;
+        int64_t periodNs;
+    };
+
+    void onSampleTimer(int64_t deadlineNs);
+    int64_t nextDeadline(int64_t deadlineNs, int64_t periodNs);
+    void onDirectReportTimer(int32_t channelHandle, int64_t deadlineNs);
+
+    int32_t mTimer;
+    /*
+     * Both buffers are reserved up front, so the event path only ever
+     * clears and refills them and never allocates.
+     */
+    std::vector<Event> mReadBuffer;
+    std::vector<Event> mPostBuffer;
+    EventFifo mFifo;
+    int32_t mBatchTimer;
+    // Keyed by channel handle
+    std::map<int32_t, DirectReport> mDirectReports;
+};
+
+/*
+ * Lets a sensor drop events based on outside state. setActive() follows
+ * whether the sensor is polling, so the gate can have its own inputs ready
+ * before the first press, and must not block. isBlocked() is asked for every
+ * press and has to fail open.
+ */
+class EventGate {
+  public:
+    virtual ~EventGate() = default;
+    virtual void setActive(bool active) = 0;
+    virtual bool isBlocked() = 0;
 };
 
 class OneShotSensor : public Sensor {
   public:
-    OneShotSensor(int32_t sensorHandle, ISensorsEventCallback* callback);
+    OneShotSensor(int32_t sensorHandle, ISensorsEventCallback* callback, EventLoop* loop);
 
-    virtual void batch(int32_t /* samplingPeriodNs */) override {}
+    virtual void batch(int32_t /* samplingPeriodNs */, int64_t /* maxReportLatencyNs */) override {}
 
     virtual Result flush() override { return Result::BAD_VALUE; }
 };
@@ -94,36 +161,56 @@ class OneShotSensor : public Sensor {
 class SysfsPollingOneShotSensor : public OneShotSensor {
   public:
     SysfsPollingOneShotSensor(int32_t sensorHandle, ISensorsEventCallback* callback,
-                              const std::string& pollPath, const std::string& name,
-                              const std::string& typeAsString, SensorType type);
+                              EventLoop* loop, const SensorDescriptor& desc,
+                              std::unique_ptr<SensorNode> node);
     virtual ~SysfsPollingOneShotSensor() override;
 
-    virtual void activate(bool enable) override;
-    virtual void activate(bool enable, bool notify, bool lock);
-    virtual void setOperationMode(OperationMode mode) override;
-    virtual std::vector<Event> readEvents() override;
+    virtual void readEvents(int64_t timestampNs, std::vector<Event>* events) override;
     virtual void fillEventData(Event& event);
 
+    // Must be set before the sensor is first enabled
+    void setEventGate(std::shared_ptr<EventGate> gate) { mGate = std::move(gate); }
+
   protected:
-    virtual void run() override;
+    virtual void reschedule() override;
 
   private:
-    void interruptPoll();
+    void onPollEvent(uint32_t events);
 
-    struct pollfd mPolls[2];
-    int mWaitPipeFd[2];
-    int mPollFd;
+    std::unique_ptr<SensorNode> mNode;
+    ValueParser mParser;
+    std::shared_ptr<EventGate> mGate;
 };
 
-const std::string kTsUdfpsPressedPath = "/sys/class/sec/tsp/input/fod_pressed";
+class SysfsOnChangeSensor : public Sensor {
+  public:
+    SysfsOnChangeSensor(int32_t sensorHandle, ISensorsEventCallback* callback, EventLoop* loop,
+                        const SensorDescriptor& desc, std::unique_ptr<SensorNode> node);
+    virtual ~SysfsOnChangeSensor() override;
+
+    virtual void readEvents(int64_t timestampNs, std::vector<Event>* events) override;
 
-class UdfpsSensor : public SysfsPollingOneShotSensor {
+  protected:
+    virtual void reschedule() override;
+
+  private:
+    void onPollEvent(uint32_t events);
+
+    std::unique_ptr<SensorNode> mNode;
+    ValueParser mParser;
+    float mValues[kMaxSensorValues];
+};
+
+class SysfsPeriodicSensor : public Sensor {
   public:
-    UdfpsSensor(int32_t sensorHandle, ISensorsEventCallback* callback)
-        : SysfsPollingOneShotSensor(
-              sensorHandle, callback, kTsUdfpsPressedPath,
-              "UDFPS Sensor", "org.lineageos.sensor.udfps",
-              static_cast<SensorType>(static_cast<int32_t>(SensorType::DEVICE_PRIVATE_BASE) + 2)) {}
+    SysfsPeriodicSensor(int32_t sensorHandle, ISensorsEventCallback* callback, EventLoop* loop,
+                        const SensorDescriptor& desc, std::unique_ptr<SensorNode> node);
+
+    virtual void readEvents(int64_t timestampNs, std::vector<Event>* events) override;
+
+  private:
+    std::unique_ptr<SensorNode> mNode;
+    ValueParser mParser;
 };
 
 }  // namespace implementation
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SensorConfig.h"
+
+#include <log/log.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+static bool parseTrigger(const std::string& str, SensorTrigger* trigger) {
+    if (str == "oneshot") {
+        *trigger = SensorTrigger::ONE_SHOT;
+    } else if (str == "onchange") {
+        *trigger = SensorTrigger::ON_CHANGE;
+    } else if (str == "periodic") {
+        *trigger = SensorTrigger::PERIODIC;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parseParser(const std::string& str, ValueParser* parser) {
+    if (str == "bool") {
+        *parser = ValueParser::BOOL;
+    } else if (str == "int") {
+        *parser = ValueParser::INT;
+    } else if (str == "int3") {
+        *parser = ValueParser::INT3;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parseLine(const std::string& line, SensorDescriptor* desc) {
+    std::istringstream stream(line);
+    std::string type, trigger, parser, wakeUp;
+
+    if (!(stream >> desc->typeAsString >> type >> trigger >> parser >> wakeUp >> desc->path)) {
+        return false;
+    }
+
+    std::getline(stream >> std::ws, desc->name);
+    if (desc->name.empty()) return false;
+
+    char* end;
+    long typeId = strtol(type.c_str(), &end, 0);
+    if (*end != '\0' || typeId <= 0) return false;
+    desc->type = static_cast<SensorType>(typeId);
+
+    if (wakeUp != "wakeup" && wakeUp != "-") return false;
+    desc->wakeUp = wakeUp == "wakeup";
+
+    return parseTrigger(trigger, &desc->trigger) && parseParser(parser, &desc->parser);
+}
+
+std::vector<SensorDescriptor> loadSensorConfig(const std::string& path) {
+    std::vector<SensorDescriptor> descs;
+    std::ifstream file(path);
+    std::string line;
+
+    if (!file.is_open()) {
+        ALOGE("failed to open sensor config %s", path.c_str());
+        return descs;
+    }
+
+    for (int lineNo = 1; std::getline(file, line); lineNo++) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#') continue;
+
+        SensorDescriptor desc;
+        if (!parseLine(line, &desc)) {
+            ALOGE("%s:%d: invalid sensor declaration", path.c_str(), lineNo);
+            continue;
+        }
+        descs.push_back(std::move(desc));
+    }
+
+    return descs;
+}
+
+bool parseSensorValue(const char* buf, ValueParser parser, float* values) {
+    if (parser == ValueParser::BOOL) {
+        if (*buf == '\0') return false;
+
+        values[0] = *buf != '0';
+        return true;
+    }
+
+    size_t count = parser == ValueParser::INT3 ? 3 : 1;
+
+    for (size_t i = 0; i < count; i++) {
+        char* end;
+        long value = strtol(buf, &end, 10);
+        if (end == buf) return false;
+
+        values[i] = value;
+        buf = end + strspn(end, " ,");
+    }
+
+    return true;
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
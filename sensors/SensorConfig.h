@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/2.1/types.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+using ::android::hardware::sensors::V2_1::SensorType;
+
+enum class SensorTrigger {
+    // POLLPRI on the node, reports once on a non-zero value and disables itself
+    ONE_SHOT,
+    // POLLPRI on the node, reports the current value whenever it changes
+    ON_CHANGE,
+    // Reads the node on every sample of a continuous sensor
+    PERIODIC,
+};
+
+enum class ValueParser {
+    // "0" is false, anything else true
+    BOOL,
+    // A single decimal integer
+    INT,
+    // Three integers separated by spaces or commas, e.g. an IIO vector
+    INT3,
+};
+
+// Values a parser can produce
+constexpr size_t kMaxSensorValues = 3;
+
+struct SensorDescriptor {
+    std::string name;
+    std::string typeAsString;
+    SensorType type;
+    std::string path;
+    SensorTrigger trigger;
+    ValueParser parser;
+    bool wakeUp;
+};
+
+/*
+ * Reads the sysfs sensor declarations, one per line:
+ *
+ *   <type string> <type> <trigger> <parser> <wakeup|-> <node path> <name>
+ *
+ * type is numeric (hex allowed), trigger one of oneshot, onchange or periodic
+ * and parser one of bool, int or int3. The name is the rest of the line.
+ * Malformed lines are logged and skipped.
+ */
+std::vector<SensorDescriptor> loadSensorConfig(const std::string& path);
+
+// Parses a node's contents into values, returns false if nothing was parsed
+bool parseSensorValue(const char* buf, ValueParser parser, float* values);
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
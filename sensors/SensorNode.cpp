@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SensorNode.h"
+
+#include <fcntl.h>
+#include <log/log.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+bool SensorNode::readValue(ValueParser parser, float* values) {
+    char buf[64];
+
+    if (!read(buf, sizeof(buf))) return false;
+
+    return parseSensorValue(buf, parser, values);
+}
+
+void SensorNode::watch(EventLoop* loop, bool enable, EventLoop::FdHandler handler) {
+    if (enable && !mWatching && ok()) {
+        mWatching = loop->addFd(pollFd(), pollEvents(), std::move(handler));
+    } else if (!enable && mWatching) {
+        loop->removeFd(pollFd());
+        mWatching = false;
+    }
+}
+
+SysfsNode::SysfsNode(const std::string& path)
+    : mPath(path), mFd(open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+    if (!mFd.ok()) {
+        ALOGE("failed to open %s: %d", path.c_str(), errno);
+    }
+}
+
+bool SysfsNode::read(char* buf, size_t size) {
+    ssize_t len = pread(mFd.get(), buf, size - 1, 0);
+    if (len <= 0) {
+        ALOGE("failed to read %s: %d", mPath.c_str(), errno);
+        return false;
+    }
+
+    buf[len] = '\0';
+    return true;
+}
+
+uint32_t SysfsNode::pollEvents() const {
+    return EPOLLPRI | EPOLLERR;
+}
+
+// sysfs_notify() raises both, anything else is not a state change
+bool SysfsNode::isNotification(uint32_t events) {
+    return events == (EPOLLPRI | EPOLLERR);
+}
+
+std::unique_ptr<SensorNode> openSysfsNode(const std::string& path) {
+    return std::make_unique<SysfsNode>(path);
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "EventLoop.h"
+#include "SensorConfig.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+/*
+ * The value source of a config declared sensor and the fd that signals its
+ * changes. On the device this is a sysfs node; off-device any pollable fd,
+ * such as a pipe or an eventfd, can stand in for sysfs_notify().
+ */
+class SensorNode {
+  public:
+    virtual ~SensorNode() = default;
+
+    virtual bool ok() const = 0;
+
+    bool readValue(ValueParser parser, float* values);
+    // Whether a wakeup with these epoll events announces a new value
+    virtual bool isNotification(uint32_t events) = 0;
+
+    bool watching() const { return mWatching; }
+    // Adds or removes the node from the loop, must run on the loop thread
+    void watch(EventLoop* loop, bool enable, EventLoop::FdHandler handler);
+
+  protected:
+    // Reads the current contents into buf, NUL terminated
+    virtual bool read(char* buf, size_t size) = 0;
+    virtual int pollFd() const = 0;
+    virtual uint32_t pollEvents() const = 0;
+
+  private:
+    bool mWatching{false};
+};
+
+/*
+ * A sysfs node that stays open and is re-read from offset 0, which also
+ * re-arms sysfs_notify() for the next POLLPRI.
+ */
+class SysfsNode : public SensorNode {
+  public:
+    explicit SysfsNode(const std::string& path);
+
+    bool ok() const override { return mFd.ok(); }
+    bool isNotification(uint32_t events) override;
+
+  protected:
+    bool read(char* buf, size_t size) override;
+    int pollFd() const override { return mFd.get(); }
+    uint32_t pollEvents() const override;
+
+  private:
+    std::string mPath;
+    ::android::base::unique_fd mFd;
+};
+
+using SensorNodeFactory = std::function<std::unique_ptr<SensorNode>(const std::string& path)>;
+
+std::unique_ptr<SensorNode> openSysfsNode(const std::string& path);
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SensorStats.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+static constexpr uint32_t kWireVarint = 0;
+static constexpr uint32_t kWireBytes = 2;
+
+void SensorStats::recordLatency(int64_t latencyNs) {
+    latencyNs = std::max<int64_t>(latencyNs, 0);
+
+    size_t bucket = 0;
+    for (uint64_t us = latencyNs / 1000; us != 0 && bucket < kNumLatencyBuckets - 1; us >>= 1) {
+        bucket++;
+    }
+    latencyHistogram[bucket]++;
+
+    latencyMinNs = latencyCount == 0 ? latencyNs : std::min(latencyMinNs, latencyNs);
+    latencyMaxNs = std::max(latencyMaxNs, latencyNs);
+    latencySumNs += latencyNs;
+    latencyCount++;
+}
+
+void SensorStats::recordJitter(int64_t latenessNs) {
+    latenessNs = std::max<int64_t>(latenessNs, 0);
+
+    jitterMaxNs = std::max(jitterMaxNs, latenessNs);
+    jitterSumNs += latenessNs;
+    jitterCount++;
+}
+
+void SensorStats::dump(std::ostream& out) const {
+    out << "Events: " << events << std::endl;
+    out << "Wakeups: " << wakeups << std::endl;
+    out << "Flushes: " << flushes << std::endl;
+    out << "Spurious polls: " << spuriousPolls << std::endl;
+    out << "Gated events: " << gatedEvents << std::endl;
+
+    if (jitterCount != 0) {
+        out << "Sample jitter (us): avg "
+            << jitterSumNs / static_cast<int64_t>(jitterCount) / 1000 << ", max "
+            << jitterMaxNs / 1000 << ", missed samples " << missedSamples << std::endl;
+    }
+
+    if (latencyCount == 0) return;
+
+    out << "Poll to post latency (us): min " << latencyMinNs / 1000 << ", avg "
+        << latencySumNs / static_cast<int64_t>(latencyCount) / 1000 << ", max "
+        << latencyMaxNs / 1000 << std::endl;
+    for (size_t i = 0; i < kNumLatencyBuckets; i++) {
+        if (latencyHistogram[i] == 0) continue;
+
+        if (i == kNumLatencyBuckets - 1) {
+            out << "  >= " << (1ULL << (i - 1)) << " us: " << latencyHistogram[i] << std::endl;
+        } else {
+            out << "  < " << (1ULL << i) << " us: " << latencyHistogram[i] << std::endl;
+        }
+    }
+}
+
+void SensorStats::dumpJson(std::ostream& out) const {
+    out << "\"events\":" << events << ",\"wakeups\":" << wakeups << ",\"flushes\":" << flushes
+        << ",\"spurious_polls\":" << spuriousPolls << ",\"gated_events\":" << gatedEvents
+        << ",\"latency_histogram\":[";
+    for (size_t i = 0; i < kNumLatencyBuckets; i++) {
+        out << (i == 0 ? "" : ",") << latencyHistogram[i];
+    }
+    out << "],\"latency_count\":" << latencyCount << ",\"latency_min_ns\":" << latencyMinNs
+        << ",\"latency_max_ns\":" << latencyMaxNs << ",\"latency_sum_ns\":" << latencySumNs
+        << ",\"jitter_count\":" << jitterCount << ",\"jitter_max_ns\":" << jitterMaxNs
+        << ",\"jitter_sum_ns\":" << jitterSumNs << ",\"missed_samples\":" << missedSamples;
+}
+
+static void appendVarint(std::string* out, uint64_t value) {
+    while (value >= 0x80) {
+        out->push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+void appendProtoVarint(std::string* out, uint32_t field, uint64_t value) {
+    appendVarint(out, field << 3 | kWireVarint);
+    appendVarint(out, value);
+}
+
+void appendProtoBytes(std::string* out, uint32_t field, const std::string& value) {
+    appendVarint(out, field << 3 | kWireBytes);
+    appendVarint(out, value.size());
+    out->append(value);
+}
+
+void dumpJsonString(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                << std::dec << std::setfill(' ');
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void SensorStats::appendProto(std::string* out) const {
+    appendProtoVarint(out, 3, events);
+    appendProtoVarint(out, 4, wakeups);
+    appendProtoVarint(out, 5, flushes);
+    appendProtoVarint(out, 6, spuriousPolls);
+
+    std::string histogram;
+    for (uint64_t count : latencyHistogram) appendVarint(&histogram, count);
+    appendProtoBytes(out, 7, histogram);
+
+    appendProtoVarint(out, 8, latencyCount);
+    appendProtoVarint(out, 9, latencyMinNs);
+    appendProtoVarint(out, 10, latencyMaxNs);
+    appendProtoVarint(out, 11, latencySumNs);
+    appendProtoVarint(out, 12, jitterCount);
+    appendProtoVarint(out, 13, jitterMaxNs);
+    appendProtoVarint(out, 14, jitterSumNs);
+    appendProtoVarint(out, 15, missedSamples);
+    appendProtoVarint(out, 16, gatedEvents);
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+/*
+ * Counters of a single sensor. Latency is measured on CLOCK_BOOTTIME from the
+ * moment the event loop returned from epoll to the moment the events were
+ * handed to the multihal proxy. Jitter is how late periodic samples were
+ * taken relative to their scheduled deadline.
+ */
+struct SensorStats {
+    // Bucket i counts latencies in [2^(i-1), 2^i) us, bucket 0 those below 1 us
+    // and the last one everything above
+    static constexpr size_t kNumLatencyBuckets = 16;
+
+    uint64_t events{0};
+    uint64_t wakeups{0};
+    uint64_t flushes{0};
+    uint64_t spuriousPolls{0};
+    // Events an EventGate dropped before they were posted
+    uint64_t gatedEvents{0};
+
+    std::array<uint64_t, kNumLatencyBuckets> latencyHistogram{};
+    uint64_t latencyCount{0};
+    int64_t latencyMinNs{0};
+    int64_t latencyMaxNs{0};
+    int64_t latencySumNs{0};
+
+    uint64_t jitterCount{0};
+    int64_t jitterMaxNs{0};
+    int64_t jitterSumNs{0};
+    uint64_t missedSamples{0};
+
+    void recordLatency(int64_t latencyNs);
+    void recordJitter(int64_t latenessNs);
+    void reset() { *this = SensorStats(); }
+
+    void dump(std::ostream& out) const;
+    void dumpJson(std::ostream& out) const;
+    /*
+     * Appends the stats as the body of:
+     *
+     * message SensorStats {
+     *     uint64 events = 3;
+     *     uint64 wakeups = 4;
+     *     uint64 flushes = 5;
+     *     uint64 spurious_polls = 6;
+     *     repeated uint64 latency_histogram = 7 [packed = true];
+     *     uint64 latency_count = 8;
+     *     int64 latency_min_ns = 9;
+     *     int64 latency_max_ns = 10;
+     *     int64 latency_sum_ns = 11;
+     *     uint64 jitter_count = 12;
+     *     int64 jitter_max_ns = 13;
+     *     int64 jitter_sum_ns = 14;
+     *     uint64 missed_samples = 15;
+     *     uint64 gated_events = 16;
+     * }
+     *
+     * Fields 1 and 2 are left to the caller for the sensor handle and name.
+     */
+    void appendProto(std::string* out) const;
+};
+
+// Protobuf wire format helpers for debug dumps
+void appendProtoVarint(std::string* out, uint32_t field, uint64_t value);
+void appendProtoBytes(std::string* out, uint32_t field, const std::string& value);
+
+// Writes value as a quoted JSON string, escaped as needed
+void dumpJsonString(std::ostream& out, const std::string& value);
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
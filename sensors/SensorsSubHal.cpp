@@ -16,9 +16,12 @@
 
 #include "SensorsSubHal.h"
 
+#include <android-base/properties.h>
 #include <android/hardware/sensors/2.1/types.h>
 #include <log/log.h>
 
+#include "PocketGate.h"
+
 using ::android::hardware::sensors::V2_1::implementation::ISensorsSubHal;
 using ::android::hardware::sensors::V2_1::subhal::implementation::SensorsSubHal;
 
@@ -30,10 +33,44 @@ namespace subhal {
 namespace implementation {
 
 using ::android::hardware::Void;
-using ::android::hardware::sensors::V2_0::implementation::ScopedWakelock;
 
-SensorsSubHal::SensorsSubHal() : mCallback(nullptr), mNextHandle(1) {
-    AddSensor<UdfpsSensor>();
+static constexpr char kUdfpsSensorType[] = "org.lineageos.sensor.udfps";
+static constexpr char kPocketGateProp[] = "persist.vendor.sensors.udfps_pocket_gate";
+
+SensorsSubHal::SensorsSubHal(const std::string& configPath, SensorNodeFactory nodeFactory)
+    : mCallback(nullptr),
+      mNodeFactory(std::move(nodeFactory)),
+      mNextHandle(1),
+      mNextChannelHandle(1) {
+    AddSensors(loadSensorConfig(configPath));
+
+    mPendingWakeupEvents.reserve(kSensorFifoCapacity);
+    mLoop.runSync([this] { mLoop.setIdleHandler([this] { postPendingWakeupEvents(); }); });
+}
+
+SensorsSubHal::~SensorsSubHal() {
+    mLoop.runSync([this] { mLoop.setIdleHandler(nullptr); });
+}
+
+void SensorsSubHal::AddSensors(const std::vector<SensorDescriptor>& descs) {
+    for (const auto& desc : descs) {
+        switch (desc.trigger) {
+            case SensorTrigger::ONE_SHOT: {
+                auto sensor = AddSensor<SysfsPollingOneShotSensor>(desc, mNodeFactory(desc.path));
+                if (desc.typeAsString == kUdfpsSensorType &&
+                    ::android::base::GetBoolProperty(kPocketGateProp, false)) {
+                    sensor->setEventGate(std::make_shared<PocketGate>());
+                }
+                break;
+            }
+            case SensorTrigger::ON_CHANGE:
+                AddSensor<SysfsOnChangeSensor>(desc, mNodeFactory(desc.path));
+                break;
+            case SensorTrigger::PERIODIC:
+                AddSensor<SysfsPeriodicSensor>(desc, mNodeFactory(desc.path));
+                break;
+        }
+    }
 }
 
 Return<void> SensorsSubHal::getSensorsList_2_1(ISensors::getSensorsList_2_1_cb _hidl_cb) {
@@ -63,10 +100,10 @@ Return<Result> SensorsSubHal::activate(int32_t sensorHandle, bool enabled) {
 }
 
 Return<Result> SensorsSubHal::batch(int32_t sensorHandle, int64_t samplingPeriodNs,
-                                    int64_t /* maxReportLatencyNs */) {
+                                    int64_t maxReportLatencyNs) {
     auto sensor = mSensors.find(sensorHandle);
     if (sensor != mSensors.end()) {
-        sensor->second->batch(samplingPeriodNs);
+        sensor->second->batch(samplingPeriodNs, maxReportLatencyNs);
         return Result::OK;
     }
     return Result::BAD_VALUE;
@@ -89,23 +126,110 @@ Return<Result> SensorsSubHal::injectSensorData_2_1(const Event& event) {
     return Result::BAD_VALUE;
 }
 
-Return<void> SensorsSubHal::registerDirectChannel(const SharedMemInfo& /* mem */,
+Return<void> SensorsSubHal::registerDirectChannel(const SharedMemInfo& mem,
                                                   ISensors::registerDirectChannel_cb _hidl_cb) {
-    _hidl_cb(Result::INVALID_OPERATION, -1 /* channelHandle */);
+    if (!DirectChannel::isSupported(mem)) {
+        _hidl_cb(Result::BAD_VALUE, -1 /* channelHandle */);
+        return Return<void>();
+    }
+
+    int32_t channelHandle = -1;
+    mLoop.runSync([&] {
+        auto channel = std::make_shared<DirectChannel>(mNextChannelHandle, mem);
+        if (!channel->isValid()) return;
+
+        channelHandle = mNextChannelHandle++;
+        mDirectChannels[channelHandle] = channel;
+    });
+
+    _hidl_cb(channelHandle > 0 ? Result::OK : Result::NO_MEMORY, channelHandle);
     return Return<void>();
 }
 
-Return<Result> SensorsSubHal::unregisterDirectChannel(int32_t /* channelHandle */) {
-    return Result::INVALID_OPERATION;
+Return<Result> SensorsSubHal::unregisterDirectChannel(int32_t channelHandle) {
+    std::shared_ptr<DirectChannel> channel;
+
+    mLoop.runSync([&] {
+        auto it = mDirectChannels.find(channelHandle);
+        if (it == mDirectChannels.end()) return;
+
+        channel = it->second;
+        mDirectChannels.erase(it);
+    });
+
+    if (channel == nullptr) {
+        return Result::BAD_VALUE;
+    }
+
+    // Sensors hold on to the mapping until their report is stopped
+    int32_t reportToken;
+    for (const auto& sensor : mSensors) {
+        if (sensor.second->supportsDirectReport()) {
+            sensor.second->configDirectReport(channel, RateLevel::STOP, &reportToken);
+        }
+    }
+
+    return Result::OK;
 }
 
-Return<void> SensorsSubHal::configDirectReport(int32_t /* sensorHandle */,
-                                               int32_t /* channelHandle */, RateLevel /* rate */,
+Return<void> SensorsSubHal::configDirectReport(int32_t sensorHandle, int32_t channelHandle,
+                                               RateLevel rate,
                                                ISensors::configDirectReport_cb _hidl_cb) {
-    _hidl_cb(Result::INVALID_OPERATION, 0 /* reportToken */);
+    std::shared_ptr<DirectChannel> channel;
+    int32_t reportToken = 0;
+
+    mLoop.runSync([&] {
+        auto it = mDirectChannels.find(channelHandle);
+        if (it != mDirectChannels.end()) channel = it->second;
+    });
+
+    if (channel == nullptr) {
+        _hidl_cb(Result::BAD_VALUE, reportToken);
+        return Return<void>();
+    }
+
+    // A handle of -1 stops every sensor on the channel
+    if (sensorHandle == -1) {
+        if (rate != RateLevel::STOP) {
+            _hidl_cb(Result::BAD_VALUE, reportToken);
+            return Return<void>();
+        }
+
+        for (const auto& sensor : mSensors) {
+            if (sensor.second->supportsDirectReport()) {
+                sensor.second->configDirectReport(channel, RateLevel::STOP, &reportToken);
+            }
+        }
+        _hidl_cb(Result::OK, 0 /* reportToken */);
+        return Return<void>();
+    }
+
+    auto sensor = mSensors.find(sensorHandle);
+    if (sensor == mSensors.end()) {
+        _hidl_cb(Result::BAD_VALUE, reportToken);
+        return Return<void>();
+    }
+
+    Result result = sensor->second->configDirectReport(channel, rate, &reportToken);
+    _hidl_cb(result, reportToken);
     return Return<void>();
 }
 
+/*
+ * Without args the sensors and their stats are dumped as text. "json" and
+ * "proto" pick another format, "reset" clears the stats after dumping them.
+ * The proto dump is a SensorsSubHalStats message:
+ *
+ * message SensorsSubHalStats {
+ *     repeated SensorStats sensor = 1;
+ *     uint64 wakelocks_acquired = 2;
+ *     uint64 wakelocks_saved = 3;
+ * }
+ *
+ * with the sensor handle and name as fields 1 and 2 of SensorStats, see
+ * SensorStats.h for the rest. Every wake-up post to the proxy acquires one
+ * wakelock; sensor posts that were merged into it count as saved.
+ */
 Return<void> SensorsSubHal::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& args) {
     if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
         ALOGE("%s: missing fd for writing", __FUNCTION__);
@@ -114,24 +238,79 @@ Return<void> SensorsSubHal::debug(const hidl_handle& fd, const hidl_vec<hidl_str
 
     FILE* out = fdopen(dup(fd->data[0]), "w");
 
-    if (args.size() != 0) {
-        fprintf(out,
-                "Note: sub-HAL %s currently does not support args. Input arguments are "
-                "ignored.\n",
-                getName().c_str());
+    bool json = false, proto = false, reset = false;
+    for (const auto& arg : args) {
+        if (arg == "json") {
+            json = true;
+        } else if (arg == "proto") {
+            proto = true;
+        } else if (arg == "reset") {
+            reset = true;
+        } else {
+            fprintf(out, "Usage: %s [json|proto] [reset]\n", getName().c_str());
+            fclose(out);
+            return Void();
+        }
     }
 
-    std::ostringstream stream;
-    stream << "Available sensors:" << std::endl;
-    for (auto sensor : mSensors) {
-        SensorInfo info = sensor.second->getSensorInfo();
-        stream << "Name: " << info.name << std::endl;
-        stream << "Min delay: " << info.minDelay << std::endl;
-        stream << "Flags: " << info.flags << std::endl;
+    uint64_t wakelocksAcquired, wakelocksSaved;
+    mLoop.runSync([&] {
+        wakelocksAcquired = mWakelocksAcquired;
+        wakelocksSaved = mWakelocksSaved;
+    });
+
+    if (proto) {
+        std::string message;
+        for (const auto& sensor : mSensors) {
+            std::string body;
+            appendProtoVarint(&body, 1, sensor.first);
+            appendProtoBytes(&body, 2, sensor.second->getSensorInfo().name);
+            sensor.second->getStats().appendProto(&body);
+            appendProtoBytes(&message, 1, body);
+        }
+        appendProtoVarint(&message, 2, wakelocksAcquired);
+        appendProtoVarint(&message, 3, wakelocksSaved);
+        fwrite(message.data(), 1, message.size(), out);
+    } else if (json) {
+        std::ostringstream stream;
+        stream << "{\"sensors\":[";
+        for (auto it = mSensors.begin(); it != mSensors.end(); ++it) {
+            stream << (it == mSensors.begin() ? "" : ",") << "{\"handle\":" << it->first
+                   << ",\"name\":";
+            dumpJsonString(stream, it->second->getSensorInfo().name);
+            stream << ",";
+            it->second->getStats().dumpJson(stream);
+            stream << "}";
+        }
+        stream << "],\"wakelocks_acquired\":" << wakelocksAcquired
+               << ",\"wakelocks_saved\":" << wakelocksSaved << "}" << std::endl;
+        fprintf(out, "%s", stream.str().c_str());
+    } else {
+        std::ostringstream stream;
+        stream << "Available sensors:" << std::endl;
+        for (auto sensor : mSensors) {
+            SensorInfo info = sensor.second->getSensorInfo();
+            stream << "Name: " << info.name << std::endl;
+            stream << "Min delay: " << info.minDelay << std::endl;
+            stream << "Flags: " << info.flags << std::endl;
+            sensor.second->getStats().dump(stream);
+        }
+        stream << "Wakelocks: acquired " << wakelocksAcquired << ", saved " << wakelocksSaved
+               << std::endl;
+        stream << std::endl;
+
+        fprintf(out, "%s", stream.str().c_str());
     }
-    stream << std::endl;
 
-    fprintf(out, "%s", stream.str().c_str());
+    if (reset) {
+        for (const auto& sensor : mSensors) {
+            sensor.second->resetStats();
+        }
+        mLoop.runSync([this] {
+            mWakelocksAcquired = 0;
+            mWakelocksSaved = 0;
+        });
+    }
 
     fclose(out);
     return Return<void>();
@@ -143,9 +322,33 @@ Return<Result> SensorsSubHal::initialize(const sp<IHalProxyCallback>& halProxyCa
     return Result::OK;
 }
 
+/*
+ * Wake-up events are held back until the current dispatch ends, so that
+ * sensors reporting on the same wakeup share one post and one wakelock. The
+ * proxy releases it as soon as the events are written to the FMQ. All posts
+ * of a sensor take the same path, so its events keep their order.
+ */
 void SensorsSubHal::postEvents(const std::vector<Event>& events, bool wakeup) {
-    ScopedWakelock wakelock = mCallback->createScopedWakelock(wakeup);
-    mCallback->postEvents(events, std::move(wakelock));
+    if (wakeup && mLoop.isLoopThread()) {
+        if (events.empty()) return;
+
+        mPendingWakeupEvents.insert(mPendingWakeupEvents.end(), events.begin(), events.end());
+        mPendingWakeupPosts++;
+        return;
+    }
+
+    mCallback->postEvents(events, mCallback->createScopedWakelock(wakeup));
+}
+
+void SensorsSubHal::postPendingWakeupEvents() {
+    if (mPendingWakeupPosts == 0) return;
+
+    mCallback->postEvents(mPendingWakeupEvents, mCallback->createScopedWakelock(true));
+    mWakelocksAcquired++;
+    mWakelocksSaved += mPendingWakeupPosts - 1;
+
+    mPendingWakeupEvents.clear();
+    mPendingWakeupPosts = 0;
 }
 
 }  // namespace implementation
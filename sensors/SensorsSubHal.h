@@ -18,7 +18,11 @@
 
 #include <vector>
 
+#include "DirectChannel.h"
+#include "EventLoop.h"
 #include "Sensor.h"
+#include "SensorConfig.h"
+#include "SensorNode.h"
 #include "V2_1/SubHal.h"
 
 namespace android {
@@ -32,13 +36,19 @@ using ::android::hardware::sensors::V1_0::OperationMode;
 using ::android::hardware::sensors::V1_0::RateLevel;
 using ::android::hardware::sensors::V1_0::Result;
 using ::android::hardware::sensors::V1_0::SharedMemInfo;
+using ::android::hardware::sensors::V2_0::implementation::ScopedWakelock;
 using ::android::hardware::sensors::V2_1::Event;
 using ::android::hardware::sensors::V2_1::implementation::IHalProxyCallback;
 using ::android::hardware::sensors::V2_1::implementation::ISensorsSubHal;
 
+const std::string kSensorConfigPath = "/vendor/etc/sensors/sysfs_sensors.conf";
+
 class SensorsSubHal : public ISensorsSubHal, public ISensorsEventCallback {
   public:
-    SensorsSubHal();
+    // Both can be replaced to run the sub-HAL against fake nodes off-device
+    explicit SensorsSubHal(const std::string& configPath = kSensorConfigPath,
+                           SensorNodeFactory nodeFactory = openSysfsNode);
+    ~SensorsSubHal();
 
     Return<void> getSensorsList_2_1(ISensors::getSensorsList_2_1_cb _hidl_cb);
     Return<Result> injectSensorData_2_1(const Event& event);
@@ -69,21 +79,45 @@ class SensorsSubHal : public ISensorsSubHal, public ISensorsEventCallback {
     void postEvents(const std::vector<Event>& events, bool wakeup) override;
 
   protected:
-    template <class SensorType>
-    void AddSensor() {
-        std::shared_ptr<SensorType> sensor =
-            std::make_shared<SensorType>(mNextHandle++ /* sensorHandle */, this /* callback */);
+    template <class SensorType, typename... Args>
+    std::shared_ptr<SensorType> AddSensor(Args&&... args) {
+        std::shared_ptr<SensorType> sensor = std::make_shared<SensorType>(
+            mNextHandle++ /* sensorHandle */, this /* callback */, &mLoop,
+            std::forward<Args>(args)...);
         mSensors[sensor->getSensorInfo().sensorHandle] = sensor;
+        return sensor;
     }
 
+    void AddSensors(const std::vector<SensorDescriptor>& descs);
+
+    // Declared before the sensors so that it outlives them
+    EventLoop mLoop;
+
     std::map<int32_t, std::shared_ptr<Sensor>> mSensors;
+    // Only accessed on the event loop
+    std::map<int32_t, std::shared_ptr<DirectChannel>> mDirectChannels;
 
     sp<IHalProxyCallback> mCallback;
 
   private:
     OperationMode mCurrentOperationMode = OperationMode::NORMAL;
 
+    SensorNodeFactory mNodeFactory;
+
     int32_t mNextHandle;
+    int32_t mNextChannelHandle;
+
+    void postPendingWakeupEvents();
+
+    /*
+     * Wake-up events posted during the current dispatch, handed to the proxy
+     * together once it ends. Only accessed on the loop.
+     */
+    std::vector<Event> mPendingWakeupEvents;
+    uint64_t mPendingWakeupPosts = 0;
+    // Wakelocks taken for proxy posts, and sensor posts that shared one
+    uint64_t mWakelocksAcquired = 0;
+    uint64_t mWakelocksSaved = 0;
 };
 
 }  // namespace implementation
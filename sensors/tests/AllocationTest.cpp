@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <thread>
+
+#include "EventLoop.h"
+#include "FakeSensorNode.h"
+#include "Sensor.h"
+#include "SensorTestUtils.h"
+
+// Only allocations made by a thread that opted in are counted
+static thread_local bool tCountAllocations = false;
+static std::atomic<size_t> gAllocations{0};
+
+void* operator new(size_t size) {
+    if (tCountAllocations) gAllocations++;
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t /* size */) noexcept {
+    free(ptr);
+}
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+// Unlike RecordingCallback this one must not allocate itself
+class CountingCallback : public ISensorsEventCallback {
+  public:
+    void postEvents(const std::vector<Event>& events, bool /* wakeup */) override {
+        mEvents += events.size();
+    }
+
+    void waitForEvents(size_t count) {
+        while (mEvents < count) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    size_t events() const { return mEvents; }
+
+  private:
+    std::atomic<size_t> mEvents{0};
+};
+
+class AllocationTest : public ::testing::Test {
+  protected:
+    void startCounting() {
+        gAllocations = 0;
+        mLoop.runSync([] { tCountAllocations = true; });
+    }
+
+    size_t stopCounting() {
+        mLoop.runSync([] { tCountAllocations = false; });
+        return gAllocations;
+    }
+
+    template <class SensorType>
+    std::unique_ptr<SensorType> makeSensor(SensorTrigger trigger, ValueParser parser,
+                                           const std::string& value) {
+        auto node = std::make_unique<FakeSensorNode>(value);
+        mNode = node.get();
+        return std::make_unique<SensorType>(1, &mCallback, &mLoop, makeDescriptor(trigger, parser),
+                                            std::move(node));
+    }
+
+    EventLoop mLoop;
+    CountingCallback mCallback;
+    FakeSensorNode* mNode{nullptr};
+};
+
+TEST_F(AllocationTest, PeriodicSamplingDoesNotAllocate) {
+    auto sensor = makeSensor<SysfsPeriodicSensor>(SensorTrigger::PERIODIC, ValueParser::INT3,
+                                                  "1 2 3");
+    sensor->batch(10 * 1000 * 1000, 0 /* maxReportLatencyNs */);
+    sensor->activate(true);
+    mCallback.waitForEvents(2);
+
+    startCounting();
+    mCallback.waitForEvents(mCallback.events() + 20);
+    EXPECT_EQ(stopCounting(), 0u);
+}
+
+TEST_F(AllocationTest, BatchedSamplingDoesNotAllocate) {
+    auto sensor = makeSensor<SysfsPeriodicSensor>(SensorTrigger::PERIODIC, ValueParser::INT, "1");
+    sensor->batch(10 * 1000 * 1000, 50 * 1000 * 1000 /* maxReportLatencyNs */);
+    sensor->activate(true);
+    // The batch timer exists once the first batch went out
+    mCallback.waitForEvents(1);
+
+    startCounting();
+    mCallback.waitForEvents(mCallback.events() + 20);
+    EXPECT_EQ(sensor->flush(), Result::OK);
+    EXPECT_EQ(stopCounting(), 0u);
+}
+
+TEST_F(AllocationTest, OnChangeEventsDoNotAllocate) {
+    auto sensor = makeSensor<SysfsOnChangeSensor>(SensorTrigger::ON_CHANGE, ValueParser::INT, "0");
+    sensor->activate(true);
+    mCallback.waitForEvents(1);
+
+    startCounting();
+    for (int i = 1; i <= 20; i++) {
+        mNode->set(std::to_string(i));
+        mCallback.waitForEvents(i + 1);
+    }
+    EXPECT_EQ(stopCounting(), 0u);
+}
+
+TEST_F(AllocationTest, OneShotEventDoesNotAllocate) {
+    auto sensor = makeSensor<SysfsPollingOneShotSensor>(SensorTrigger::ONE_SHOT, ValueParser::BOOL,
+                                                        "0");
+
+    for (int i = 1; i <= 5; i++) {
+        // Re-arming registers the node with the loop again, which may allocate
+        sensor->activate(true);
+
+        startCounting();
+        mNode->set("1");
+        mCallback.waitForEvents(i);
+        EXPECT_EQ(stopCounting(), 0u);
+
+        mNode->set("0");
+    }
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "DirectChannel.h"
+#include "FakeSensorNode.h"
+#include "Sensor.h"
+#include "SensorTestUtils.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+using ::android::hardware::sensors::V1_0::SensorsEventFormatOffset;
+
+static constexpr size_t offsetOf(SensorsEventFormatOffset offset) {
+    return static_cast<size_t>(offset);
+}
+
+static constexpr size_t kRecordSize = offsetOf(SensorsEventFormatOffset::TOTAL_LENGTH);
+static constexpr size_t kNumRecords = 4;
+
+// A memfd backed channel plus a mapping of it that plays the reader
+class DirectChannelTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mFd.reset(memfd_create("direct_channel_test", MFD_CLOEXEC));
+        ASSERT_TRUE(mFd.ok());
+        ASSERT_EQ(ftruncate(mFd.get(), kNumRecords * kRecordSize), 0);
+
+        void* base = mmap(nullptr, kNumRecords * kRecordSize, PROT_READ, MAP_SHARED, mFd.get(), 0);
+        ASSERT_NE(base, MAP_FAILED);
+        mReader = static_cast<const uint8_t*>(base);
+
+        mChannel = std::make_shared<DirectChannel>(7, mFd.get(), kNumRecords * kRecordSize);
+        ASSERT_TRUE(mChannel->isValid());
+    }
+
+    void TearDown() override {
+        mChannel.reset();
+        if (mReader != nullptr) munmap(const_cast<uint8_t*>(mReader), kNumRecords * kRecordSize);
+    }
+
+    template <typename T>
+    T field(size_t record, SensorsEventFormatOffset offset) {
+        T value;
+        memcpy(&value, mReader + record * kRecordSize + offsetOf(offset), sizeof(value));
+        return value;
+    }
+
+    uint32_t counter(size_t record) {
+        auto* counter = reinterpret_cast<const std::atomic<uint32_t>*>(
+            mReader + record * kRecordSize + offsetOf(SensorsEventFormatOffset::ATOMIC_COUNTER));
+        return counter->load(std::memory_order_acquire);
+    }
+
+    static Event makeEvent(int64_t timestamp, float value) {
+        Event event;
+        event.sensorHandle = 1;
+        event.sensorType = SensorType::ACCELEROMETER;
+        event.timestamp = timestamp;
+        std::fill(std::begin(event.u.data), std::end(event.u.data), 0.0f);
+        event.u.data[0] = value;
+        return event;
+    }
+
+    ::android::base::unique_fd mFd;
+    const uint8_t* mReader{nullptr};
+    std::shared_ptr<DirectChannel> mChannel;
+};
+
+TEST_F(DirectChannelTest, UnwrittenRecordsHaveZeroCounter) {
+    for (size_t i = 0; i < kNumRecords; i++) EXPECT_EQ(counter(i), 0u);
+}
+
+TEST_F(DirectChannelTest, WritesSensorsEventLayout) {
+    mChannel->write(makeEvent(123456789, 4.5f), 42);
+
+    EXPECT_EQ(counter(0), 1u);
+    EXPECT_EQ(field<int32_t>(0, SensorsEventFormatOffset::SIZE_FIELD),
+              static_cast<int32_t>(kRecordSize));
+    EXPECT_EQ(field<int32_t>(0, SensorsEventFormatOffset::REPORT_TOKEN), 42);
+    EXPECT_EQ(field<int32_t>(0, SensorsEventFormatOffset::SENSOR_TYPE),
+              static_cast<int32_t>(SensorType::ACCELEROMETER));
+    EXPECT_EQ(field<int64_t>(0, SensorsEventFormatOffset::TIMESTAMP), 123456789);
+    EXPECT_EQ(field<float>(0, SensorsEventFormatOffset::DATA), 4.5f);
+    EXPECT_EQ(counter(1), 0u);
+}
+
+TEST_F(DirectChannelTest, CountersIncreaseAcrossWraparound) {
+    for (size_t i = 0; i < kNumRecords + 2; i++) {
+        mChannel->write(makeEvent(i, i), 1);
+    }
+
+    // The two newest events overwrote the oldest records
+    EXPECT_EQ(counter(0), kNumRecords + 1);
+    EXPECT_EQ(counter(1), kNumRecords + 2);
+    EXPECT_EQ(counter(2), 3u);
+    EXPECT_EQ(counter(3), 4u);
+    EXPECT_EQ(field<int64_t>(0, SensorsEventFormatOffset::TIMESTAMP), kNumRecords);
+    EXPECT_EQ(field<int64_t>(1, SensorsEventFormatOffset::TIMESTAMP), kNumRecords + 1);
+}
+
+TEST_F(DirectChannelTest, ReaderNeverSeesTornRecords) {
+    std::atomic<bool> done{false};
+
+    // Each event carries its timestamp as data, so a torn record shows as a mismatch
+    std::thread writer([&] {
+        for (int64_t i = 1; i <= 100000; i++) mChannel->write(makeEvent(i, i), 1);
+        done = true;
+    });
+
+    size_t checked = 0;
+    while (!done) {
+        for (size_t i = 0; i < kNumRecords; i++) {
+            uint32_t before = counter(i);
+            if (before == 0) continue;
+
+            int64_t timestamp = field<int64_t>(i, SensorsEventFormatOffset::TIMESTAMP);
+            float value = field<float>(i, SensorsEventFormatOffset::DATA);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (counter(i) != before) continue;
+
+            EXPECT_EQ(static_cast<float>(timestamp), value);
+            checked++;
+        }
+    }
+    writer.join();
+
+    EXPECT_GT(checked, 0u);
+}
+
+TEST_F(DirectChannelTest, SensorReportsAtRateLevel) {
+    EventLoop loop;
+    RecordingCallback callback;
+    SysfsPeriodicSensor sensor(1, &callback, &loop,
+                               makeDescriptor(SensorTrigger::PERIODIC, ValueParser::INT),
+                               std::make_unique<FakeSensorNode>("9"));
+    int32_t token = 0;
+
+    ASSERT_EQ(sensor.configDirectReport(mChannel, RateLevel::NORMAL, &token), Result::OK);
+    EXPECT_EQ(token, 1);
+
+    while (counter(1) == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_EQ(sensor.configDirectReport(mChannel, RateLevel::STOP, &token), Result::OK);
+
+    // NORMAL is nominally 50 Hz
+    EXPECT_EQ(field<int64_t>(1, SensorsEventFormatOffset::TIMESTAMP) -
+                  field<int64_t>(0, SensorsEventFormatOffset::TIMESTAMP),
+              20 * 1000 * 1000);
+    EXPECT_EQ(field<float>(1, SensorsEventFormatOffset::DATA), 9.0f);
+    EXPECT_EQ(field<int32_t>(1, SensorsEventFormatOffset::REPORT_TOKEN), 1);
+    // Direct reports bypass the event callback
+    EXPECT_EQ(callback.posts(), 0u);
+}
+
+TEST_F(DirectChannelTest, RejectsRatesAboveTheSensorMaximum) {
+    EventLoop loop;
+    RecordingCallback callback;
+    SysfsPeriodicSensor sensor(1, &callback, &loop,
+                               makeDescriptor(SensorTrigger::PERIODIC, ValueParser::INT),
+                               std::make_unique<FakeSensorNode>());
+    int32_t token = -1;
+
+    EXPECT_EQ(sensor.configDirectReport(mChannel, RateLevel::FAST, &token), Result::BAD_VALUE);
+    EXPECT_EQ(token, 0);
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
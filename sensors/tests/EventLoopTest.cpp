@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+#include <dirent.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "FakeSensorNode.h"
+#include "Sensor.h"
+#include "SensorTestUtils.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+static constexpr int64_t kNsPerMs = 1000 * 1000;
+
+TEST(EventLoopTest, RunSyncRunsOnLoopThread) {
+    EventLoop loop;
+    bool onLoop = false;
+
+    loop.runSync([&] { onLoop = loop.isLoopThread(); });
+
+    EXPECT_TRUE(onLoop);
+    EXPECT_FALSE(loop.isLoopThread());
+}
+
+TEST(EventLoopTest, PostedCommandsRunInOrder) {
+    EventLoop loop;
+    std::vector<int> order;
+
+    for (int i = 0; i < 100; i++) {
+        loop.post([&order, i] { order.push_back(i); });
+    }
+    loop.runSync([] {});
+
+    ASSERT_EQ(order.size(), 100u);
+    for (int i = 0; i < 100; i++) EXPECT_EQ(order[i], i);
+}
+
+TEST(EventLoopTest, TimersFireInDeadlineOrder) {
+    EventLoop loop;
+    std::vector<int> order;
+    std::atomic<int> fired{0};
+
+    loop.runSync([&] {
+        int64_t now = EventLoop::now();
+        for (int i : {3, 1, 2}) {
+            int32_t timer = loop.createTimer([&order, &fired, i](int64_t) {
+                order.push_back(i);
+                fired++;
+            });
+            loop.armTimer(timer, now + i * 5 * kNsPerMs);
+        }
+    });
+
+    while (fired < 3) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    loop.runSync([&] { EXPECT_EQ(order, (std::vector<int>{1, 2, 3})); });
+}
+
+TEST(EventLoopTest, TimerHandlerGetsItsDeadline) {
+    EventLoop loop;
+    std::atomic<int64_t> got{0};
+    int64_t deadline = EventLoop::now() + 5 * kNsPerMs;
+
+    loop.runSync([&] {
+        int32_t timer = loop.createTimer([&](int64_t deadlineNs) { got = deadlineNs; });
+        loop.armTimer(timer, deadline);
+    });
+
+    while (got == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(got, deadline);
+}
+
+TEST(EventLoopTest, CancelledTimerDoesNotFire) {
+    EventLoop loop;
+    std::atomic<bool> fired{false};
+
+    loop.runSync([&] {
+        int32_t timer = loop.createTimer([&](int64_t) { fired = true; });
+        loop.armTimer(timer, EventLoop::now() + 5 * kNsPerMs);
+        loop.cancelTimer(timer);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(fired);
+}
+
+TEST(EventLoopTest, TimerHandlerCanDestroyItsTimer) {
+    EventLoop loop;
+    std::atomic<int> fired{0};
+    int32_t timer = 0;
+
+    loop.runSync([&] {
+        timer = loop.createTimer([&](int64_t) {
+            fired++;
+            loop.destroyTimer(timer);
+        });
+        loop.armTimer(timer, EventLoop::now());
+    });
+
+    while (fired == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    syncLoop(&loop);
+    loop.runSync([&] { loop.armTimer(timer, EventLoop::now()); });
+    syncLoop(&loop);
+    EXPECT_EQ(fired, 1);
+}
+
+TEST(EventLoopTest, FdHandlerRunsUntilRemoved) {
+    EventLoop loop;
+    ::android::base::unique_fd fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    std::atomic<int> wakeups{0};
+
+    loop.runSync([&] {
+        loop.addFd(fd.get(), EPOLLIN, [&](uint32_t) {
+            eventfd_t count;
+            eventfd_read(fd.get(), &count);
+            wakeups++;
+        });
+    });
+
+    eventfd_write(fd.get(), 1);
+    syncLoop(&loop);
+    EXPECT_EQ(wakeups, 1);
+
+    loop.runSync([&] { loop.removeFd(fd.get()); });
+    eventfd_write(fd.get(), 1);
+    syncLoop(&loop);
+    EXPECT_EQ(wakeups, 1);
+}
+
+// The loop's epoll instance is the only one in the process while the test runs
+static int findEpollFd() {
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir("/proc/self/fd"), closedir);
+    if (!dir) return -1;
+
+    while (struct dirent* entry = readdir(dir.get())) {
+        std::string path = std::string("/proc/self/fd/") + entry->d_name;
+        char target[64] = {};
+        if (readlink(path.c_str(), target, sizeof(target) - 1) < 0) continue;
+        if (std::string(target) == "anon_inode:[eventpoll]") return atoi(entry->d_name);
+    }
+    return -1;
+}
+
+TEST(EventLoopTest, RunSyncSurvivesDeadLoop) {
+    EventLoop loop;
+    int epollFd = findEpollFd();
+    ASSERT_GE(epollFd, 0);
+
+    // Swap the epoll fd for an eventfd, the next epoll_wait fails with EINVAL
+    ::android::base::unique_fd bogus(eventfd(0, EFD_CLOEXEC));
+    ASSERT_GE(dup2(bogus.get(), epollFd), 0);
+
+    int ran = 0;
+    loop.runSync([&] { ran++; });
+    loop.runSync([&] { ran++; });
+    loop.post([&] { ran++; });
+
+    EXPECT_EQ(ran, 3);
+}
+
+class SysfsSensorTest : public ::testing::Test {
+  protected:
+    template <class SensorType>
+    std::unique_ptr<SensorType> makeSensor(SensorTrigger trigger, ValueParser parser,
+                                           const std::string& value = "0") {
+        auto node = std::make_unique<FakeSensorNode>(value);
+        mNode = node.get();
+        return std::make_unique<SensorType>(1, &mCallback, &mLoop, makeDescriptor(trigger, parser),
+                                            std::move(node));
+    }
+
+    EventLoop mLoop;
+    RecordingCallback mCallback;
+    FakeSensorNode* mNode{nullptr};
+};
+
+TEST_F(SysfsSensorTest, OneShotIgnoresPressesWhileDisabled) {
+    auto sensor = makeSensor<SysfsPollingOneShotSensor>(SensorTrigger::ONE_SHOT, ValueParser::BOOL);
+
+    mNode->set("1");
+    syncLoop(&mLoop);
+
+    EXPECT_EQ(mCallback.events().size(), 0u);
+    EXPECT_EQ(mNode->reads(), 0u);
+}
+
+TEST_F(SysfsSensorTest, OneShotReportsOnceAndDisablesItself) {
+    auto sensor = makeSensor<SysfsPollingOneShotSensor>(SensorTrigger::ONE_SHOT, ValueParser::BOOL);
+    sensor->activate(true);
+
+    mNode->set("1");
+    ASSERT_TRUE(mCallback.waitForEvents(1));
+
+    mNode->set("0");
+    mNode->set("1");
+    syncLoop(&mLoop);
+
+    std::vector<Event> events = mCallback.events();
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].sensorHandle, 1);
+    EXPECT_EQ(events[0].sensorType, makeDescriptor(SensorTrigger::ONE_SHOT, ValueParser::BOOL).type);
+    EXPECT_GT(events[0].timestamp, 0);
+
+    // Re-arming works like the framework does it after every event
+    sensor->activate(true);
+    syncLoop(&mLoop);
+    ASSERT_TRUE(mCallback.waitForEvents(2));
+}
+
+TEST_F(SysfsSensorTest, OneShotSkipsReleaseAndSpuriousWakeups) {
+    auto sensor = makeSensor<SysfsPollingOneShotSensor>(SensorTrigger::ONE_SHOT, ValueParser::BOOL);
+    sensor->activate(true);
+
+    mNode->set("0");
+    syncLoop(&mLoop);
+    mNode->wakeSpuriously();
+    syncLoop(&mLoop);
+
+    EXPECT_EQ(mCallback.events().size(), 0u);
+    EXPECT_EQ(sensor->getStats().spuriousPolls, 2u);
+}
+
+class FakeGate : public EventGate {
+  public:
+    void setActive(bool active) override { mActive.push_back(active); }
+    bool isBlocked() override { return mBlocked; }
+
+    std::vector<bool> mActive;
+    bool mBlocked{false};
+};
+
+TEST_F(SysfsSensorTest, OneShotGateFollowsPolling) {
+    auto sensor = makeSensor<SysfsPollingOneShotSensor>(SensorTrigger::ONE_SHOT, ValueParser::BOOL);
+    auto gate = std::make_shared<FakeGate>();
+    gate->mBlocked = true;
+    sensor->setEventGate(gate);
+    sensor->activate(true);
+
+    mNode->set("1");
+    syncLoop(&mLoop);
+    mNode->set("0");
+    syncLoop(&mLoop);
+    EXPECT_EQ(mCallback.events().size(), 0u);
+    EXPECT_EQ(sensor->getStats().gatedEvents, 1u);
+
+    mLoop.runSync([&] { gate->mBlocked = false; });
+    mNode->set("1");
+    ASSERT_TRUE(mCallback.waitForEvents(1));
+    syncLoop(&mLoop);
+
+    // Active from enabling on, so the first press already has readings, until
+    // the sensor disabled itself
+    mLoop.runSync([&] { EXPECT_EQ(gate->mActive, (std::vector<bool>{true, false})); });
+}
+
+TEST_F(SysfsSensorTest, OnChangeReportsCurrentValueOnEnable) {
+    auto sensor =
+        makeSensor<SysfsOnChangeSensor>(SensorTrigger::ON_CHANGE, ValueParser::INT3, "1 2 3");
+    sensor->activate(true);
+
+    ASSERT_TRUE(mCallback.waitForEvents(1));
+    Event event = mCallback.events()[0];
+    EXPECT_EQ(event.u.data[0], 1.0f);
+    EXPECT_EQ(event.u.data[1], 2.0f);
+    EXPECT_EQ(event.u.data[2], 3.0f);
+}
+
+TEST_F(SysfsSensorTest, OnChangeReportsOnlyChanges) {
+    auto sensor = makeSensor<SysfsOnChangeSensor>(SensorTrigger::ON_CHANGE, ValueParser::INT, "5");
+    sensor->activate(true);
+    ASSERT_TRUE(mCallback.waitForEvents(1));
+
+    mNode->set("5");
+    syncLoop(&mLoop);
+    EXPECT_EQ(mCallback.events().size(), 1u);
+
+    mNode->set("7");
+    ASSERT_TRUE(mCallback.waitForEvents(2));
+    EXPECT_EQ(mCallback.events()[1].u.data[0], 7.0f);
+
+    sensor->activate(false);
+    mNode->set("9");
+    syncLoop(&mLoop);
+    EXPECT_EQ(mCallback.events().size(), 2u);
+}
+
+TEST_F(SysfsSensorTest, PeriodicSamplesOnSchedule) {
+    auto sensor = makeSensor<SysfsPeriodicSensor>(SensorTrigger::PERIODIC, ValueParser::INT, "42");
+    int64_t periodNs = 10 * kNsPerMs;
+    sensor->batch(periodNs, 0 /* maxReportLatencyNs */);
+    sensor->activate(true);
+
+    ASSERT_TRUE(mCallback.waitForEvents(5));
+    sensor->activate(false);
+
+    std::vector<Event> events = mCallback.events();
+    for (size_t i = 0; i < events.size(); i++) {
+        EXPECT_EQ(events[i].u.data[0], 42.0f);
+        if (i > 0) EXPECT_EQ(events[i].timestamp - events[i - 1].timestamp, periodNs);
+    }
+}
+
+TEST_F(SysfsSensorTest, PeriodicSkipsFailedReads) {
+    auto sensor = makeSensor<SysfsPeriodicSensor>(SensorTrigger::PERIODIC, ValueParser::INT, "42");
+    mNode->setReadError(true);
+    sensor->batch(10 * kNsPerMs, 0 /* maxReportLatencyNs */);
+    sensor->activate(true);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sensor->activate(false);
+
+    EXPECT_EQ(mCallback.events().size(), 0u);
+    EXPECT_GT(mNode->reads(), 0u);
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
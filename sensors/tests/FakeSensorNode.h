@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "SensorNode.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+/*
+ * Stands in for a sysfs node, with an eventfd as the poll source.
+ *
+ * set() changes the contents and raises a notification like sysfs_notify().
+ * As with sysfs, a notification stays pending until the node is re-read, and
+ * several set() calls before that read coalesce into a single wakeup that sees
+ * the latest value. wakeSpuriously() wakes the watcher without a notification,
+ * as POLLERR without POLLPRI would, which is consumed by looking at it.
+ */
+class FakeSensorNode : public SensorNode {
+  public:
+    explicit FakeSensorNode(const std::string& value = "0")
+        : mEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), mValue(value) {}
+
+    bool ok() const override { return mEventFd.ok(); }
+
+    void set(const std::string& value) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mValue = value;
+            mNotified = true;
+        }
+        eventfd_write(mEventFd.get(), 1);
+    }
+
+    void wakeSpuriously() { eventfd_write(mEventFd.get(), 1); }
+
+    // Makes reads fail, like a node whose device went away
+    void setReadError(bool error) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReadError = error;
+    }
+
+    size_t reads() const { return mReads; }
+
+    bool isNotification(uint32_t events) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mNotified) return events & EPOLLIN;
+
+        eventfd_t count;
+        eventfd_read(mEventFd.get(), &count);
+        return false;
+    }
+
+  protected:
+    bool read(char* buf, size_t size) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReads++;
+        if (mReadError) return false;
+
+        // Re-reading re-arms the notification
+        eventfd_t count;
+        eventfd_read(mEventFd.get(), &count);
+        mNotified = false;
+
+        strncpy(buf, mValue.c_str(), size - 1);
+        buf[size - 1] = '\0';
+        return true;
+    }
+
+    int pollFd() const override { return mEventFd.get(); }
+    uint32_t pollEvents() const override { return EPOLLIN; }
+
+  private:
+    ::android::base::unique_fd mEventFd;
+
+    std::mutex mMutex;
+    std::string mValue;
+    bool mNotified{false};
+    bool mReadError{false};
+    std::atomic<size_t> mReads{0};
+};
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "EventLoop.h"
+#include "Sensor.h"
+#include "SensorTestUtils.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+static constexpr int64_t kNsPerSec = 1000LL * 1000 * 1000;
+static constexpr int64_t kPeriodNs = kNsPerSec / 200;
+static constexpr int64_t kRunNs = 5 * kNsPerSec;
+
+// A continuous sensor that can sample faster than the 200 Hz under test
+class FastSensor : public Sensor {
+  public:
+    FastSensor(ISensorsEventCallback* callback, EventLoop* loop) : Sensor(1, callback, loop) {
+        mSensorInfo.type = SensorType::ACCELEROMETER;
+        mSensorInfo.minDelay = 1000;
+    }
+};
+
+TEST(SamplingRateTest, HoldsTwoHundredHertzWithoutDrift) {
+    EventLoop loop;
+    RecordingCallback callback;
+    FastSensor sensor(&callback, &loop);
+
+    sensor.batch(kPeriodNs, 0 /* maxReportLatencyNs */);
+    int64_t start = EventLoop::now();
+    sensor.activate(true);
+    std::this_thread::sleep_for(std::chrono::nanoseconds(kRunNs));
+    sensor.activate(false);
+    int64_t end = EventLoop::now();
+
+    std::vector<Event> events = callback.events();
+    ASSERT_GT(events.size(), 1u);
+
+    // Every sample is stamped with its deadline, exactly one period apart
+    for (size_t i = 1; i < events.size(); i++) {
+        ASSERT_EQ(events[i].timestamp - events[i - 1].timestamp, kPeriodNs) << "sample " << i;
+    }
+
+    // And the schedule kept up with the clock over the whole run
+    EXPECT_GE(events.front().timestamp, start);
+    EXPECT_LE(events.back().timestamp, end);
+    EXPECT_LT(end - events.back().timestamp, 2 * kPeriodNs);
+    EXPECT_NEAR(static_cast<double>(events.size()),
+                static_cast<double>(end - events.front().timestamp) / kPeriodNs, 2.0);
+
+    SensorStats stats = sensor.getStats();
+    EXPECT_EQ(stats.missedSamples, 0u);
+    EXPECT_EQ(stats.jitterCount, events.size());
+    // Single wakeups may be late on a busy machine, the typical one is not
+    EXPECT_LT(stats.jitterSumNs / static_cast<int64_t>(stats.jitterCount), kPeriodNs / 2);
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "FakeSensorNode.h"
+#include "Sensor.h"
+#include "SensorTestUtils.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+static constexpr int kIterations = 2000;
+
+/*
+ * Hammers the control entry points from several HAL threads while the node
+ * keeps notifying, then checks that the sensor settled in the state the last
+ * calls asked for.
+ */
+class SensorRaceTest : public ::testing::Test {
+  protected:
+    template <class SensorType>
+    std::unique_ptr<SensorType> makeSensor(SensorTrigger trigger, ValueParser parser) {
+        auto node = std::make_unique<FakeSensorNode>();
+        mNode = node.get();
+        return std::make_unique<SensorType>(1, &mCallback, &mLoop, makeDescriptor(trigger, parser),
+                                            std::move(node));
+    }
+
+    void race(std::vector<std::function<void(int)>> workers) {
+        std::atomic<bool> stop{false};
+        std::thread notifier([&] {
+            for (int i = 0; !stop; i++) mNode->set(std::to_string(i % 2 + 1));
+        });
+
+        std::vector<std::thread> threads;
+        for (auto& worker : workers) {
+            threads.emplace_back([&worker] {
+                for (int i = 0; i < kIterations; i++) worker(i);
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        stop = true;
+        notifier.join();
+        syncLoop(&mLoop);
+    }
+
+    // Whether a new value is reported, and reported only once
+    bool reportsNextValue(const std::string& value) {
+        size_t count = mCallback.events().size();
+        mNode->set(value);
+        syncLoop(&mLoop);
+        return mCallback.events().size() == count + 1;
+    }
+
+    bool staysSilent() {
+        size_t count = mCallback.events().size();
+        mNode->set("7");
+        syncLoop(&mLoop);
+        return mCallback.events().size() == count;
+    }
+
+    EventLoop mLoop;
+    RecordingCallback mCallback;
+    FakeSensorNode* mNode{nullptr};
+};
+
+TEST_F(SensorRaceTest, OnChangeActivateDeactivate) {
+    auto sensor = makeSensor<SysfsOnChangeSensor>(SensorTrigger::ON_CHANGE, ValueParser::INT);
+
+    race({[&](int i) { sensor->activate(i % 2 == 0); },
+          [&](int i) { sensor->activate(i % 3 == 0); }});
+
+    sensor->activate(false);
+    EXPECT_TRUE(staysSilent());
+
+    sensor->activate(true);
+    syncLoop(&mLoop);
+    EXPECT_TRUE(reportsNextValue("9"));
+}
+
+TEST_F(SensorRaceTest, OnChangeOperationMode) {
+    auto sensor = makeSensor<SysfsOnChangeSensor>(SensorTrigger::ON_CHANGE, ValueParser::INT);
+
+    race({[&](int i) { sensor->activate(i % 2 == 0); },
+          [&](int i) {
+              sensor->setOperationMode(i % 2 == 0 ? OperationMode::DATA_INJECTION
+                                                  : OperationMode::NORMAL);
+          }});
+
+    sensor->activate(true);
+    sensor->setOperationMode(OperationMode::DATA_INJECTION);
+    EXPECT_TRUE(staysSilent());
+
+    sensor->setOperationMode(OperationMode::NORMAL);
+    syncLoop(&mLoop);
+    EXPECT_TRUE(reportsNextValue("9"));
+}
+
+TEST_F(SensorRaceTest, OneShotActivateDeactivate) {
+    auto sensor =
+        makeSensor<SysfsPollingOneShotSensor>(SensorTrigger::ONE_SHOT, ValueParser::INT);
+
+    race({[&](int i) { sensor->activate(i % 2 == 0); },
+          [&](int i) { sensor->activate(i % 5 != 0); },
+          [&](int i) {
+              sensor->setOperationMode(i % 7 == 0 ? OperationMode::DATA_INJECTION
+                                                  : OperationMode::NORMAL);
+          }});
+
+    sensor->setOperationMode(OperationMode::NORMAL);
+    sensor->activate(false);
+    EXPECT_TRUE(staysSilent());
+
+    // Like with sysfs the notification stays pending, let it read as released
+    mNode->set("0");
+    // Reports once, then disabled itself again
+    sensor->activate(true);
+    syncLoop(&mLoop);
+    EXPECT_TRUE(reportsNextValue("9"));
+    EXPECT_TRUE(staysSilent());
+}
+
+TEST_F(SensorRaceTest, PeriodicBatchAndActivate) {
+    auto sensor = makeSensor<SysfsPeriodicSensor>(SensorTrigger::PERIODIC, ValueParser::INT);
+
+    race({[&](int i) { sensor->activate(i % 2 == 0); },
+          [&](int i) {
+              sensor->batch((10 + i % 10) * 1000 * 1000, (i % 3) * 20 * 1000 * 1000);
+          },
+          [&](int /* i */) { sensor->flush(); }});
+
+    sensor->activate(false);
+    syncLoop(&mLoop);
+    size_t count = mCallback.events().size();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(mCallback.events().size(), count);
+
+    sensor->batch(10 * 1000 * 1000, 0 /* maxReportLatencyNs */);
+    sensor->activate(true);
+    EXPECT_TRUE(mCallback.waitForEvents(count + 3));
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
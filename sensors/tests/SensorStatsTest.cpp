@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <iomanip>
+#include <sstream>
+
+#include "SensorStats.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+static std::string jsonString(const std::string& value) {
+    std::ostringstream stream;
+    dumpJsonString(stream, value);
+    return stream.str();
+}
+
+TEST(SensorStatsTest, JsonStringsAreEscaped) {
+    EXPECT_EQ(jsonString("UDFPS Sensor"), "\"UDFPS Sensor\"");
+    EXPECT_EQ(jsonString("a \"quoted\" name"), "\"a \\\"quoted\\\" name\"");
+    EXPECT_EQ(jsonString("back\\slash"), "\"back\\\\slash\"");
+    EXPECT_EQ(jsonString("tab\there"), "\"tab\\u0009here\"");
+}
+
+TEST(SensorStatsTest, EscapingLeavesStreamFormatAlone) {
+    std::ostringstream stream;
+    dumpJsonString(stream, "\n");
+    stream << 26 << std::setw(3) << 1;
+
+    EXPECT_EQ(stream.str(), "\"\\u000a\"26  1");
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include "EventLoop.h"
+#include "Sensor.h"
+#include "SensorConfig.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+// Keeps everything a sensor posts, posts come from the loop thread
+class RecordingCallback : public ISensorsEventCallback {
+  public:
+    void postEvents(const std::vector<Event>& events, bool wakeup) override {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mEvents.insert(mEvents.end(), events.begin(), events.end());
+            mPosts++;
+            if (wakeup) mWakeupPosts++;
+        }
+        mCv.notify_all();
+    }
+
+    // Whether at least count events arrived within timeout
+    bool waitForEvents(size_t count,
+                       std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mCv.wait_for(lock, timeout, [&] { return mEvents.size() >= count; });
+    }
+
+    std::vector<Event> events() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEvents;
+    }
+
+    size_t posts() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mPosts;
+    }
+
+    size_t wakeupPosts() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mWakeupPosts;
+    }
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    std::vector<Event> mEvents;
+    size_t mPosts{0};
+    size_t mWakeupPosts{0};
+};
+
+/*
+ * Returns once the loop handled every fd that was ready before the call. A
+ * command alone is not enough, it may run ahead of fds in the same epoll batch,
+ * but a timer armed from it can only fire in a later batch.
+ */
+inline void syncLoop(EventLoop* loop) {
+    std::promise<void> fired;
+    int32_t timer = 0;
+
+    loop->runSync([&] {
+        timer = loop->createTimer([&](int64_t) { fired.set_value(); });
+        loop->armTimer(timer, EventLoop::now());
+    });
+    fired.get_future().wait();
+    loop->runSync([&] { loop->destroyTimer(timer); });
+}
+
+inline SensorDescriptor makeDescriptor(SensorTrigger trigger, ValueParser parser,
+                                       bool wakeUp = false) {
+    SensorDescriptor desc;
+    desc.name = "Test Sensor";
+    desc.typeAsString = "org.lineageos.sensor.test";
+    desc.type = static_cast<SensorType>(0x10100);
+    desc.path = "/fake/node";
+    desc.trigger = trigger;
+    desc.parser = parser;
+    desc.wakeUp = wakeUp;
+    return desc;
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "FakeSensorNode.h"
+#include "SensorTestUtils.h"
+#include "SensorsSubHal.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_0 {
+namespace implementation {
+
+// Befriended by ScopedWakelock, which is only constructed by the proxy
+class ScopedWakelockTest {
+  public:
+    static ScopedWakelock create(IScopedWakelockRefCounter* refCounter, bool locked) {
+        return ScopedWakelock(refCounter, locked);
+    }
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+using ::android::hardware::sensors::V2_0::implementation::IScopedWakelockRefCounter;
+using ::android::hardware::sensors::V2_0::implementation::ScopedWakelockTest;
+
+/*
+ * Plays the multihal proxy: hands out refcounted wakelocks, and like the
+ * proxy drops the one that came with a post once its events are written.
+ */
+class FakeHalProxyCallback : public IHalProxyCallback, public IScopedWakelockRefCounter {
+  public:
+    struct Post {
+        std::vector<Event> events;
+        bool locked;
+    };
+
+    Return<void> onDynamicSensorsConnected_2_1(const hidl_vec<SensorInfo>& /* added */) override {
+        return Void();
+    }
+    Return<void> onDynamicSensorsConnected(
+            const hidl_vec<V1_0::SensorInfo>& /* added */) override {
+        return Void();
+    }
+    Return<void> onDynamicSensorsDisconnected(const hidl_vec<int32_t>& /* removed */) override {
+        return Void();
+    }
+
+    ScopedWakelock createScopedWakelock(bool lock) override {
+        return ScopedWakelockTest::create(this, lock);
+    }
+
+    void postEvents(const std::vector<Event>& events, ScopedWakelock wakelock) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPosts.push_back({events, wakelock.isLocked()});
+    }
+
+    bool incrementRefCountAndMaybeAcquireWakelock(size_t delta, int64_t* timeoutStart) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mRefCount == 0) mAcquired++;
+        mRefCount += delta;
+        if (timeoutStart != nullptr) *timeoutStart = EventLoop::now();
+        return true;
+    }
+
+    void decrementRefCountAndMaybeReleaseWakelock(size_t delta,
+                                                  int64_t /* timeoutStart */) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRefCount -= delta;
+    }
+
+    std::vector<Post> posts() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mPosts;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPosts.clear();
+        mAcquired = 0;
+    }
+
+    // Times the wakelock went from released to held
+    size_t acquired() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mAcquired;
+    }
+
+    size_t refCount() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mRefCount;
+    }
+
+  private:
+    std::mutex mMutex;
+    std::vector<Post> mPosts;
+    size_t mAcquired{0};
+    size_t mRefCount{0};
+};
+
+static constexpr char kConfig[] =
+    "org.lineageos.sensor.a 0x10101 onchange int wakeup /fake/a Wake-up A\n"
+    "org.lineageos.sensor.b 0x10102 onchange int wakeup /fake/b Wake-up B\n"
+    "org.lineageos.sensor.c 0x10103 onchange int - /fake/c Non-wake-up C\n";
+
+class TestSubHal : public SensorsSubHal {
+  public:
+    TestSubHal(const std::string& configPath, SensorNodeFactory nodeFactory)
+        : SensorsSubHal(configPath, std::move(nodeFactory)) {}
+
+    EventLoop* loop() { return &mLoop; }
+};
+
+class SensorsSubHalTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        ASSERT_TRUE(::android::base::WriteStringToFile(kConfig, mConfig.path));
+        mSubHal = std::make_unique<TestSubHal>(mConfig.path, [this](const std::string& path) {
+            auto node = std::make_unique<FakeSensorNode>();
+            mNodes[path] = node.get();
+            return node;
+        });
+        mSubHal->initialize(mCallback);
+
+        // Handles are assigned in config order
+        for (int32_t handle : {1, 2, 3}) mSubHal->activate(handle, true);
+        syncLoop(mSubHal->loop());
+        mCallback->clear();
+    }
+
+    void TearDown() override {
+        for (int32_t handle : {1, 2, 3}) mSubHal->activate(handle, false);
+    }
+
+    TemporaryFile mConfig;
+    std::map<std::string, FakeSensorNode*> mNodes;
+    sp<FakeHalProxyCallback> mCallback = new FakeHalProxyCallback();
+    std::unique_ptr<TestSubHal> mSubHal;
+};
+
+TEST_F(SensorsSubHalTest, WakeupEventsOfOneDispatchShareOneWakelock) {
+    // Both notifications are pending before the loop looks at either
+    mSubHal->loop()->runSync([&] {
+        mNodes["/fake/a"]->set("1");
+        mNodes["/fake/b"]->set("2");
+    });
+    syncLoop(mSubHal->loop());
+
+    std::vector<FakeHalProxyCallback::Post> posts = mCallback->posts();
+    ASSERT_EQ(posts.size(), 1u);
+    EXPECT_TRUE(posts[0].locked);
+    ASSERT_EQ(posts[0].events.size(), 2u);
+    EXPECT_EQ(mCallback->acquired(), 1u);
+}
+
+TEST_F(SensorsSubHalTest, WakelockIsReleasedOnDelivery) {
+    mNodes["/fake/a"]->set("1");
+    syncLoop(mSubHal->loop());
+
+    ASSERT_EQ(mCallback->posts().size(), 1u);
+    // Nothing keeps the AP awake once the events are in the FMQ
+    EXPECT_EQ(mCallback->refCount(), 0u);
+}
+
+TEST_F(SensorsSubHalTest, SeparateWakeupsTakeSeparateWakelocks) {
+    for (int i = 1; i <= 3; i++) {
+        mNodes["/fake/a"]->set(std::to_string(i));
+        syncLoop(mSubHal->loop());
+    }
+
+    std::vector<FakeHalProxyCallback::Post> posts = mCallback->posts();
+    ASSERT_EQ(posts.size(), 3u);
+    for (int i = 0; i < 3; i++) EXPECT_EQ(posts[i].events[0].u.data[0], i + 1.0f);
+    EXPECT_EQ(mCallback->acquired(), 3u);
+}
+
+TEST_F(SensorsSubHalTest, NonWakeupEventsTakeNoWakelock) {
+    mNodes["/fake/c"]->set("1");
+    syncLoop(mSubHal->loop());
+
+    std::vector<FakeHalProxyCallback::Post> posts = mCallback->posts();
+    ASSERT_EQ(posts.size(), 1u);
+    EXPECT_FALSE(posts[0].locked);
+    EXPECT_EQ(mCallback->acquired(), 0u);
+}
+
+TEST_F(SensorsSubHalTest, FlushCompleteFollowsPendingWakeupEvents) {
+    Event event;
+    event.sensorHandle = 1;
+    event.sensorType = static_cast<SensorType>(0x10101);
+    event.timestamp = EventLoop::now();
+    event.u.data[0] = 5.0f;
+
+    // As if sensor 1 reported earlier in the dispatch that runs the flush
+    mSubHal->loop()->runSync([&] {
+        mSubHal->postEvents({event}, true /* wakeup */);
+        mSubHal->flush(1);
+    });
+    syncLoop(mSubHal->loop());
+
+    std::vector<FakeHalProxyCallback::Post> posts = mCallback->posts();
+    ASSERT_EQ(posts.size(), 1u);
+    ASSERT_EQ(posts[0].events.size(), 2u);
+    EXPECT_EQ(posts[0].events[0].u.data[0], 5.0f);
+    EXPECT_EQ(posts[0].events[1].sensorType, SensorType::META_DATA);
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
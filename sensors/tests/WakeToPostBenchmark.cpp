@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "EventLoop.h"
+#include "FakeSensorNode.h"
+#include "Sensor.h"
+#include "SensorTestUtils.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+// Notes when the last post arrived, spinning readers see it without a syscall
+class TimingCallback : public ISensorsEventCallback {
+  public:
+    void postEvents(const std::vector<Event>& /* events */, bool /* wakeup */) override {
+        mPostNs.store(EventLoop::now(), std::memory_order_release);
+        mPosts.fetch_add(1, std::memory_order_release);
+    }
+
+    // Returns when post number count arrived
+    int64_t waitForPost(uint64_t count) {
+        while (mPosts.load(std::memory_order_acquire) < count) {
+        }
+        return mPostNs.load(std::memory_order_acquire);
+    }
+
+    uint64_t posts() const { return mPosts.load(std::memory_order_acquire); }
+
+  private:
+    std::atomic<int64_t> mPostNs{0};
+    std::atomic<uint64_t> mPosts{0};
+};
+
+/*
+ * From the node notification to the event reaching the callback, which
+ * covers the epoll wakeup, the read and parse of the node and the post.
+ */
+static void BM_OneShotWakeToPost(benchmark::State& state) {
+    EventLoop loop;
+    TimingCallback callback;
+    auto node = std::make_unique<FakeSensorNode>();
+    FakeSensorNode* fake = node.get();
+    SysfsPollingOneShotSensor sensor(1, &callback, &loop,
+                                     makeDescriptor(SensorTrigger::ONE_SHOT, ValueParser::BOOL,
+                                                    true /* wakeUp */),
+                                     std::move(node));
+
+    for (auto _ : state) {
+        // Re-armed like the framework does after every event, outside the timing
+        sensor.activate(true);
+
+        uint64_t posts = callback.posts();
+        int64_t start = EventLoop::now();
+        fake->set("1");
+        int64_t end = callback.waitForPost(posts + 1);
+
+        state.SetIterationTime((end - start) / 1e9);
+        fake->set("0");
+    }
+}
+BENCHMARK(BM_OneShotWakeToPost)->UseManualTime()->Unit(benchmark::kMicrosecond);
+
+static void BM_OnChangeWakeToPost(benchmark::State& state) {
+    EventLoop loop;
+    TimingCallback callback;
+    auto node = std::make_unique<FakeSensorNode>("0 0 0");
+    FakeSensorNode* fake = node.get();
+    SysfsOnChangeSensor sensor(1, &callback, &loop,
+                               makeDescriptor(SensorTrigger::ON_CHANGE, ValueParser::INT3),
+                               std::move(node));
+    sensor.activate(true);
+    callback.waitForPost(1);
+
+    int value = 0;
+    for (auto _ : state) {
+        uint64_t posts = callback.posts();
+        int64_t start = EventLoop::now();
+        fake->set(std::to_string(++value) + " 0 0");
+        int64_t end = callback.waitForPost(posts + 1);
+
+        state.SetIterationTime((end - start) / 1e9);
+    }
+}
+BENCHMARK(BM_OnChangeWakeToPost)->UseManualTime()->Unit(benchmark::kMicrosecond);
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
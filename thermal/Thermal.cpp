@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "android.hardware.thermal-service.a70q"
+
+#include "Thermal.h"
+
+#include <android-base/logging.h>
+
+#include <algorithm>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace thermal {
+namespace impl {
+
+Thermal::Thermal(const std::string& sysfsRoot)
+    : mHelper(std::make_unique<ThermalHelper>(
+              sysfsRoot, [this](const Temperature& t) { notifyThrottling(t); })) {}
+
+ndk::ScopedAStatus Thermal::getCoolingDevices(std::vector<CoolingDevice>* _aidl_return) {
+    mHelper->getCoolingDevices(false, CoolingType::CPU, _aidl_return);
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus Thermal::getCoolingDevicesWithType(CoolingType in_type,
+                                                      std::vector<CoolingDevice>* _aidl_return) {
+    mHelper->getCoolingDevices(true, in_type, _aidl_return);
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus Thermal::getTemperatures(std::vector<Temperature>* _aidl_return) {
+    mHelper->getTemperatures(false, TemperatureType::UNKNOWN, _aidl_return);
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus Thermal::getTemperaturesWithType(TemperatureType in_type,
+                                                    std::vector<Temperature>* _aidl_return) {
+    mHelper->getTemperatures(true, in_type, _aidl_return);
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus Thermal::getTemperatureThresholds(
+        std::vector<TemperatureThreshold>* _aidl_return) {
+    mHelper->getThresholds(false, TemperatureType::UNKNOWN, _aidl_return);
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus Thermal::getTemperatureThresholdsWithType(
+        TemperatureType in_type, std::vector<TemperatureThreshold>* _aidl_return) {
+    mHelper->getThresholds(true, in_type, _aidl_return);
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus Thermal::registerThermalChangedCallback(
+        const std::shared_ptr<IThermalChangedCallback>& in_callback) {
+    return registerCallback(in_callback, false, TemperatureType::UNKNOWN);
+}
+
+ndk::ScopedAStatus Thermal::registerThermalChangedCallbackWithType(
+        const std::shared_ptr<IThermalChangedCallback>& in_callback, TemperatureType in_type) {
+    return registerCallback(in_callback, true, in_type);
+}
+
+ndk::ScopedAStatus Thermal::registerCallback(
+        const std::shared_ptr<IThermalChangedCallback>& callback, bool filterType,
+        TemperatureType type) {
+    if (callback == nullptr) {
+        return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
+                                                                "Invalid nullptr callback");
+    }
+
+    std::lock_guard<std::mutex> lock(mCallbackMutex);
+    if (std::any_of(mCallbacks.begin(), mCallbacks.end(), [&](const CallbackSetting& c) {
+            return c.callback->asBinder() == callback->asBinder();
+        })) {
+        return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
+                                                                "Callback already registered");
+    }
+
+    mCallbacks.push_back({callback, filterType, type});
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus Thermal::unregisterThermalChangedCallback(
+        const std::shared_ptr<IThermalChangedCallback>& in_callback) {
+    if (in_callback == nullptr) {
+        return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
+                                                                "Invalid nullptr callback");
+    }
+
+    std::lock_guard<std::mutex> lock(mCallbackMutex);
+    auto it = std::remove_if(mCallbacks.begin(), mCallbacks.end(), [&](const CallbackSetting& c) {
+        return c.callback->asBinder() == in_callback->asBinder();
+    });
+    if (it == mCallbacks.end()) {
+        return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
+                                                                "Callback wasn't registered");
+    }
+
+    mCallbacks.erase(it, mCallbacks.end());
+    return ndk::ScopedAStatus::ok();
+}
+
+void Thermal::notifyThrottling(const Temperature& temperature) {
+    std::lock_guard<std::mutex> lock(mCallbackMutex);
+
+    auto it = mCallbacks.begin();
+    while (it != mCallbacks.end()) {
+        if (it->filterType && it->type != temperature.type) {
+            ++it;
+            continue;
+        }
+
+        if (!it->callback->notifyThrottling(temperature).isOk()) {
+            LOG(ERROR) << "Dropping dead thermal callback";
+            it = mCallbacks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+binder_status_t Thermal::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    mHelper->dump(fd);
+    return STATUS_OK;
+}
+
+}  // namespace impl
+}  // namespace thermal
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
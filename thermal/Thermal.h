@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/thermal/BnThermal.h>
+
+#include "ThermalHelper.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace thermal {
+namespace impl {
+
+class Thermal : public BnThermal {
+  public:
+    explicit Thermal(const std::string& sysfsRoot = "/sys");
+
+    ndk::ScopedAStatus getCoolingDevices(std::vector<CoolingDevice>* _aidl_return) override;
+    ndk::ScopedAStatus getCoolingDevicesWithType(CoolingType in_type,
+                                                 std::vector<CoolingDevice>* _aidl_return) override;
+    ndk::ScopedAStatus getTemperatures(std::vector<Temperature>* _aidl_return) override;
+    ndk::ScopedAStatus getTemperaturesWithType(TemperatureType in_type,
+                                               std::vector<Temperature>* _aidl_return) override;
+    ndk::ScopedAStatus getTemperatureThresholds(
+            std::vector<TemperatureThreshold>* _aidl_return) override;
+    ndk::ScopedAStatus getTemperatureThresholdsWithType(
+            TemperatureType in_type, std::vector<TemperatureThreshold>* _aidl_return) override;
+    ndk::ScopedAStatus registerThermalChangedCallback(
+            const std::shared_ptr<IThermalChangedCallback>& in_callback) override;
+    ndk::ScopedAStatus registerThermalChangedCallbackWithType(
+            const std::shared_ptr<IThermalChangedCallback>& in_callback,
+            TemperatureType in_type) override;
+    ndk::ScopedAStatus unregisterThermalChangedCallback(
+            const std::shared_ptr<IThermalChangedCallback>& in_callback) override;
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+  private:
+    struct CallbackSetting {
+        std::shared_ptr<IThermalChangedCallback> callback;
+        bool filterType;
+        TemperatureType type;
+    };
+
+    ndk::ScopedAStatus registerCallback(const std::shared_ptr<IThermalChangedCallback>& callback,
+                                        bool filterType, TemperatureType type);
+    void notifyThrottling(const Temperature& temperature);
+
+    std::mutex mCallbackMutex;
+    std::vector<CallbackSetting> mCallbacks;
+    // Last member, so its poll thread stops before the callbacks go away
+    std::unique_ptr<ThermalHelper> mHelper;
+};
+
+}  // namespace impl
+}  // namespace thermal
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
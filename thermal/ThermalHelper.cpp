@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "android.hardware.thermal-service.a70q"
+
+#include "ThermalHelper.h"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cmath>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace thermal {
+namespace impl {
+
+using ::android::base::ReadFileToString;
+using ::android::base::StringPrintf;
+using ::android::base::Trim;
+
+static constexpr float kNan = NAN;
+
+/* SDM675 thermal zones, thresholds in degrees Celsius */
+static const Thresholds kCpuThresholds = {kNan, 85, 90, 95, 100, 105, 115};
+static const Thresholds kSkinThresholds = {kNan, 41, 43, 45, 47, 50, 60};
+static const Thresholds kBatteryThresholds = {kNan, 42, 45, 48, 52, 56, 68};
+
+static const SensorConfig kSensorConfigs[] = {
+        {"cpuss-0", TemperatureType::CPU, "cpuss-0-usr", nullptr, 0.001f, kCpuThresholds},
+        {"cpuss-1", TemperatureType::CPU, "cpuss-1-usr", nullptr, 0.001f, kCpuThresholds},
+        {"cpuss-2", TemperatureType::CPU, "cpuss-2-usr", nullptr, 0.001f, kCpuThresholds},
+        {"cpu-1-0", TemperatureType::CPU, "cpu-1-0-usr", nullptr, 0.001f, kCpuThresholds},
+        {"cpu-1-1", TemperatureType::CPU, "cpu-1-1-usr", nullptr, 0.001f, kCpuThresholds},
+        {"cpu-1-2", TemperatureType::CPU, "cpu-1-2-usr", nullptr, 0.001f, kCpuThresholds},
+        {"cpu-1-3", TemperatureType::CPU, "cpu-1-3-usr", nullptr, 0.001f, kCpuThresholds},
+        {"gpu", TemperatureType::GPU, "gpu-usr", nullptr, 0.001f, kCpuThresholds},
+        {"skin", TemperatureType::SKIN, nullptr, "/devices/virtual/sec/sec-ap-thermistor/temperature",
+         0.1f, kSkinThresholds},
+        {"battery", TemperatureType::BATTERY, nullptr, "/class/power_supply/battery/temp", 0.1f,
+         kBatteryThresholds},
+};
+
+// Smoothing factors of the temperature and slope filters
+static constexpr float kTempAlpha = 0.4f;
+static constexpr float kSlopeAlpha = 0.3f;
+// A severity is only left once the temperature is this far below its threshold
+static constexpr float kHysteresis = 2.0f;
+// How far ahead the headroom forecast looks
+static constexpr float kForecastSec = 10.0f;
+// Span used by the framework to normalize headroom, SEVERE maps to 1.0
+static constexpr float kHeadroomSpan = 30.0f;
+
+static constexpr auto kPollInterval = std::chrono::milliseconds(2000);
+static constexpr auto kFastPollInterval = std::chrono::milliseconds(500);
+static constexpr float kFastPollHeadroom = 0.8f;
+
+static bool readFloat(int fd, float* value) {
+    char buf[32];
+    ssize_t len = TEMP_FAILURE_RETRY(pread(fd, buf, sizeof(buf) - 1, 0));
+    if (len <= 0) return false;
+
+    buf[len] = '\0';
+    char* end;
+    *value = strtof(buf, &end);
+    return end != buf;
+}
+
+static ::android::base::unique_fd openNode(const std::string& path, int flags) {
+    ::android::base::unique_fd fd(open(path.c_str(), flags | O_CLOEXEC));
+    if (!fd.ok()) PLOG(WARNING) << "Failed to open " << path;
+    return fd;
+}
+
+static CoolingType coolingTypeFromName(const std::string& name) {
+    if (::android::base::StartsWith(name, "thermal-cpufreq") ||
+        ::android::base::StartsWith(name, "cpu-isolate"))
+        return CoolingType::CPU;
+    if (::android::base::StartsWith(name, "gpu") || ::android::base::StartsWith(name, "kgsl"))
+        return CoolingType::GPU;
+    if (::android::base::StartsWith(name, "battery")) return CoolingType::BATTERY;
+    if (::android::base::StartsWith(name, "modem")) return CoolingType::MODEM;
+    if (::android::base::StartsWith(name, "cdsp") || ::android::base::StartsWith(name, "npu"))
+        return CoolingType::NPU;
+
+    return CoolingType::COMPONENT;
+}
+
+ThermalHelper::ThermalHelper(const std::string& sysfsRoot, NotifyCallback notify,
+                             bool startPolling)
+    : mSysfsRoot(sysfsRoot), mNotify(std::move(notify)) {
+    discoverSensors();
+    discoverCoolingDevices();
+
+    if (startPolling) mThread = std::thread(&ThermalHelper::pollLoop, this);
+}
+
+ThermalHelper::~ThermalHelper() {
+    if (!mThread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExit = true;
+    }
+    mCv.notify_all();
+    mThread.join();
+}
+
+/*
+ * Walks the thermal zones once to map zone types onto the configured sensors.
+ */
+void ThermalHelper::discoverSensors() {
+    const std::string zoneRoot = mSysfsRoot + "/class/thermal";
+    std::vector<std::pair<std::string, std::string>> zones;
+
+    if (DIR* dir = opendir(zoneRoot.c_str())) {
+        while (struct dirent* entry = readdir(dir)) {
+            std::string type;
+            const std::string zone = zoneRoot + "/" + entry->d_name;
+
+            if (!::android::base::StartsWith(entry->d_name, "thermal_zone")) continue;
+            if (!ReadFileToString(zone + "/type", &type)) continue;
+
+            zones.emplace_back(Trim(type), zone + "/temp");
+        }
+        closedir(dir);
+    }
+
+    for (const auto& config : kSensorConfigs) {
+        std::string path;
+
+        if (config.path != nullptr) {
+            path = mSysfsRoot + config.path;
+        } else {
+            for (const auto& [type, temp] : zones) {
+                if (type == config.zoneType) path = temp;
+            }
+        }
+
+        if (path.empty()) {
+            LOG(WARNING) << "No thermal zone for " << config.name;
+            continue;
+        }
+
+        Sensor sensor{.config = &config, .fd = openNode(path, O_RDONLY)};
+        if (sensor.fd.ok()) mSensors.push_back(std::move(sensor));
+    }
+}
+
+void ThermalHelper::discoverCoolingDevices() {
+    const std::string coolingRoot = mSysfsRoot + "/class/thermal";
+
+    if (DIR* dir = opendir(coolingRoot.c_str())) {
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name;
+            const std::string device = coolingRoot + "/" + entry->d_name;
+
+            if (!::android::base::StartsWith(entry->d_name, "cooling_device")) continue;
+            if (!ReadFileToString(device + "/type", &name)) continue;
+
+            name = Trim(name);
+            Cooling cooling{.name = name,
+                            .type = coolingTypeFromName(name),
+                            .fd = openNode(device + "/cur_state", O_RDONLY)};
+            if (cooling.fd.ok()) mCoolingDevices.push_back(std::move(cooling));
+        }
+        closedir(dir);
+    }
+}
+
+bool ThermalHelper::sample(Sensor* sensor, float dtSec) {
+    float raw;
+
+    if (!readFloat(sensor->fd.get(), &raw)) return false;
+
+    sensor->raw = raw * sensor->config->multiplier;
+
+    if (!sensor->initialized) {
+        sensor->filtered = sensor->raw;
+        sensor->slope = 0;
+        sensor->initialized = true;
+        return true;
+    }
+
+    float previous = sensor->filtered;
+    sensor->filtered += kTempAlpha * (sensor->raw - sensor->filtered);
+    if (dtSec > 0) {
+        float slope = (sensor->filtered - previous) / dtSec;
+        sensor->slope += kSlopeAlpha * (slope - sensor->slope);
+    }
+
+    return true;
+}
+
+ThrottlingSeverity ThermalHelper::computeSeverity(const Sensor& sensor) const {
+    const Thresholds& hot = sensor.config->hotThresholds;
+    size_t current = static_cast<size_t>(sensor.severity);
+    size_t level = 0;
+
+    for (size_t i = 1; i < kNumSeverities; i++) {
+        if (!std::isnan(hot[i]) && sensor.filtered >= hot[i]) level = i;
+    }
+
+    // Only step down once we are clearly below the threshold we crossed
+    while (current > level && !std::isnan(hot[current]) &&
+           sensor.filtered < hot[current] - kHysteresis) {
+        current--;
+    }
+    if (level < current && !std::isnan(hot[current])) level = current;
+
+    return static_cast<ThrottlingSeverity>(level);
+}
+
+float ThermalHelper::forecastHeadroom(const Sensor& sensor) const {
+    float severe = sensor.config->hotThresholds[static_cast<size_t>(ThrottlingSeverity::SEVERE)];
+    if (std::isnan(severe)) return kNan;
+
+    float forecast = sensor.filtered + std::max(sensor.slope, 0.0f) * kForecastSec;
+    return (forecast - (severe - kHeadroomSpan)) / kHeadroomSpan;
+}
+
+Temperature ThermalHelper::toTemperature(const Sensor& sensor) const {
+    return {.type = sensor.config->type,
+            .name = sensor.config->name,
+            .value = sensor.filtered,
+            .throttlingStatus = sensor.severity};
+}
+
+bool ThermalHelper::poll(float dtSec) {
+    std::vector<Temperature> changed;
+    bool fast = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& sensor : mSensors) {
+            if (!sample(&sensor, dtSec)) continue;
+
+            ThrottlingSeverity severity = computeSeverity(sensor);
+            if (severity != sensor.severity) {
+                sensor.severity = severity;
+                changed.push_back(toTemperature(sensor));
+            }
+
+            if (sensor.severity != ThrottlingSeverity::NONE ||
+                forecastHeadroom(sensor) >= kFastPollHeadroom) {
+                fast = true;
+            }
+        }
+    }
+
+    // Only threshold crossings are reported, never plain updates
+    for (const auto& temperature : changed) {
+        LOG(INFO) << temperature.name << " crossed into "
+                  << toString(temperature.throttlingStatus) << " at " << temperature.value;
+        mNotify(temperature);
+    }
+
+    return fast;
+}
+
+void ThermalHelper::pollLoop() {
+    auto last = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mExit) {
+        auto now = std::chrono::steady_clock::now();
+        float dtSec = std::chrono::duration<float>(now - last).count();
+        last = now;
+
+        lock.unlock();
+        bool fast = poll(dtSec);
+        lock.lock();
+
+        mCv.wait_for(lock, fast ? kFastPollInterval : kPollInterval, [this] { return mExit; });
+    }
+}
+
+void ThermalHelper::getTemperatures(bool filterType, TemperatureType type,
+                                    std::vector<Temperature>* temperatures) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (const auto& sensor : mSensors) {
+        if (!sensor.initialized || (filterType && sensor.config->type != type)) continue;
+        temperatures->push_back(toTemperature(sensor));
+    }
+}
+
+void ThermalHelper::getThresholds(bool filterType, TemperatureType type,
+                                  std::vector<TemperatureThreshold>* thresholds) {
+    for (const auto& sensor : mSensors) {
+        if (filterType && sensor.config->type != type) continue;
+
+        const Thresholds& hot = sensor.config->hotThresholds;
+        thresholds->push_back({.type = sensor.config->type,
+                               .name = sensor.config->name,
+                               .hotThrottlingThresholds = {hot.begin(), hot.end()},
+                               .coldThrottlingThresholds = std::vector<float>(kNumSeverities, kNan)});
+    }
+}
+
+void ThermalHelper::getCoolingDevices(bool filterType, CoolingType type,
+                                      std::vector<CoolingDevice>* devices) {
+    for (const auto& cooling : mCoolingDevices) {
+        float state;
+
+        if (filterType && cooling.type != type) continue;
+        if (!readFloat(cooling.fd.get(), &state)) continue;
+
+        devices->push_back({.type = cooling.type,
+                            .name = cooling.name,
+                            .value = static_cast<int64_t>(state)});
+    }
+}
+
+void ThermalHelper::dump(int fd) {
+    std::string out = "Sensors:\n";
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto& sensor : mSensors) {
+            out += StringPrintf("  %-10s raw %6.1f filtered %6.1f slope %+5.2f/s %-9s headroom %.2f\n",
+                                sensor.config->name, sensor.raw, sensor.filtered, sensor.slope,
+                                toString(sensor.severity).c_str(), forecastHeadroom(sensor));
+        }
+    }
+
+    out += "Cooling devices:\n";
+    for (const auto& cooling : mCoolingDevices) {
+        float state = 0;
+        readFloat(cooling.fd.get(), &state);
+        out += StringPrintf("  %-24s %s %d\n", cooling.name.c_str(),
+                            toString(cooling.type).c_str(), static_cast<int>(state));
+    }
+
+    ::android::base::WriteStringToFd(out, fd);
+}
+
+}  // namespace impl
+}  // namespace thermal
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
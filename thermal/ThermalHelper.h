@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/thermal/CoolingDevice.h>
+#include <aidl/android/hardware/thermal/Temperature.h>
+#include <aidl/android/hardware/thermal/TemperatureThreshold.h>
+#include <android-base/unique_fd.h>
+
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using ::aidl::android::hardware::thermal::CoolingDevice;
+using ::aidl::android::hardware::thermal::CoolingType;
+using ::aidl::android::hardware::thermal::Temperature;
+using ::aidl::android::hardware::thermal::TemperatureThreshold;
+using ::aidl::android::hardware::thermal::TemperatureType;
+using ::aidl::android::hardware::thermal::ThrottlingSeverity;
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace thermal {
+namespace impl {
+
+// One threshold per ThrottlingSeverity, NONE first
+constexpr size_t kNumSeverities = static_cast<size_t>(ThrottlingSeverity::SHUTDOWN) + 1;
+using Thresholds = std::array<float, kNumSeverities>;
+
+struct SensorConfig {
+    const char* name;
+    TemperatureType type;
+    // Either a thermal zone type to look up, or a node relative to the sysfs root
+    const char* zoneType;
+    const char* path;
+    // Converts the raw reading to degrees Celsius
+    float multiplier;
+    Thresholds hotThresholds;
+};
+
+/*
+ * Owns every temperature sensor and cooling device of the device. All nodes
+ * are opened once; a single poll thread samples them, smooths the readings
+ * and reports severity changes through the notify callback.
+ */
+class ThermalHelper {
+  public:
+    using NotifyCallback = std::function<void(const Temperature&)>;
+
+    // sysfsRoot is "/sys" on the device and a fake tree in tests, which call poll() themselves
+    ThermalHelper(const std::string& sysfsRoot, NotifyCallback notify, bool startPolling = true);
+    ~ThermalHelper();
+
+    // Samples every sensor once and reports crossings, returns whether to poll faster
+    bool poll(float dtSec);
+
+    void getTemperatures(bool filterType, TemperatureType type,
+                         std::vector<Temperature>* temperatures);
+    void getThresholds(bool filterType, TemperatureType type,
+                       std::vector<TemperatureThreshold>* thresholds);
+    void getCoolingDevices(bool filterType, CoolingType type,
+                           std::vector<CoolingDevice>* devices);
+
+    void dump(int fd);
+
+  private:
+    struct Sensor {
+        const SensorConfig* config;
+        ::android::base::unique_fd fd;
+        bool initialized{false};
+        // Exponentially smoothed temperature and its slope in degrees per second
+        float filtered{0};
+        float slope{0};
+        float raw{0};
+        ThrottlingSeverity severity{ThrottlingSeverity::NONE};
+    };
+
+    struct Cooling {
+        std::string name;
+        CoolingType type;
+        ::android::base::unique_fd fd;
+    };
+
+    void discoverSensors();
+    void discoverCoolingDevices();
+    void pollLoop();
+    bool sample(Sensor* sensor, float dtSec);
+    ThrottlingSeverity computeSeverity(const Sensor& sensor) const;
+    float forecastHeadroom(const Sensor& sensor) const;
+    Temperature toTemperature(const Sensor& sensor) const;
+
+    std::string mSysfsRoot;
+    NotifyCallback mNotify;
+
+    std::vector<Sensor> mSensors;
+    std::vector<Cooling> mCoolingDevices;
+    std::mutex mMutex;
+
+    std::thread mThread;
+    std::condition_variable mCv;
+    bool mExit{false};
+};
+
+}  // namespace impl
+}  // namespace thermal
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "ThermalHelper.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace thermal {
+namespace impl {
+
+using ::android::base::WriteStringToFile;
+
+// A sysfs tree with one CPU zone, the skin thermistor and a cooling device
+class FakeThermalTree {
+  public:
+    FakeThermalTree() {
+        mkdirs("/class/thermal/thermal_zone0");
+        WriteStringToFile("cpuss-0-usr\n", path("/class/thermal/thermal_zone0/type"));
+        setCpu(40000);
+
+        mkdirs("/devices/virtual/sec/sec-ap-thermistor");
+        setSkin(300);
+
+        mkdirs("/class/thermal/cooling_device0");
+        WriteStringToFile("thermal-cpufreq-0\n", path("/class/thermal/cooling_device0/type"));
+        WriteStringToFile("2\n", path("/class/thermal/cooling_device0/cur_state"));
+    }
+
+    std::string root() const { return mDir.path; }
+
+    // Millidegrees, as thermal zones report them
+    void setCpu(int value) {
+        WriteStringToFile(std::to_string(value) + "\n",
+                          path("/class/thermal/thermal_zone0/temp"));
+    }
+
+    // Tenths of a degree, as the thermistor reports them
+    void setSkin(int value) {
+        WriteStringToFile(std::to_string(value) + "\n",
+                          path("/devices/virtual/sec/sec-ap-thermistor/temperature"));
+    }
+
+  private:
+    std::string path(const std::string& relative) const { return root() + relative; }
+
+    // Creates every directory along relative, which starts with a slash
+    void mkdirs(const std::string& relative) {
+        size_t end = 0;
+        do {
+            end = relative.find('/', end + 1);
+            mkdir(path(relative.substr(0, end)).c_str(), 0755);
+        } while (end != std::string::npos);
+    }
+
+    TemporaryDir mDir;
+};
+
+static float temperatureOf(ThermalHelper* helper, TemperatureType type) {
+    std::vector<Temperature> temperatures;
+    helper->getTemperatures(true, type, &temperatures);
+    return temperatures.empty() ? NAN : temperatures[0].value;
+}
+
+TEST(ThermalHelperTest, SmoothsReadings) {
+    FakeThermalTree tree;
+    ThermalHelper helper(tree.root(), [](const Temperature&) {}, false);
+
+    // The first reading is taken as is
+    helper.poll(2.0f);
+    EXPECT_FLOAT_EQ(temperatureOf(&helper, TemperatureType::CPU), 40.0f);
+
+    // Then each one moves the filtered value 40% of the way
+    tree.setCpu(50000);
+    helper.poll(2.0f);
+    EXPECT_FLOAT_EQ(temperatureOf(&helper, TemperatureType::CPU), 44.0f);
+    helper.poll(2.0f);
+    EXPECT_FLOAT_EQ(temperatureOf(&helper, TemperatureType::CPU), 46.4f);
+}
+
+TEST(ThermalHelperTest, NotifiesOnlyOnCrossings) {
+    FakeThermalTree tree;
+    std::vector<Temperature> notified;
+    ThermalHelper helper(tree.root(), [&](const Temperature& t) { notified.push_back(t); }, false);
+
+    helper.poll(2.0f);
+    EXPECT_TRUE(notified.empty());
+
+    // LIGHT is at 41C
+    tree.setSkin(420);
+    for (int i = 0; i < 20; i++) helper.poll(2.0f);
+    ASSERT_EQ(notified.size(), 1u);
+    EXPECT_EQ(notified[0].type, TemperatureType::SKIN);
+    EXPECT_EQ(notified[0].throttlingStatus, ThrottlingSeverity::LIGHT);
+
+    // Below the threshold, but within the 2C of hysteresis
+    tree.setSkin(395);
+    for (int i = 0; i < 20; i++) helper.poll(2.0f);
+    EXPECT_EQ(notified.size(), 1u);
+
+    tree.setSkin(380);
+    for (int i = 0; i < 20; i++) helper.poll(2.0f);
+    ASSERT_EQ(notified.size(), 2u);
+    EXPECT_EQ(notified[1].throttlingStatus, ThrottlingSeverity::NONE);
+}
+
+TEST(ThermalHelperTest, ListsCoolingDevices) {
+    FakeThermalTree tree;
+    ThermalHelper helper(tree.root(), [](const Temperature&) {}, false);
+
+    std::vector<CoolingDevice> devices;
+    helper.getCoolingDevices(false, CoolingType::CPU, &devices);
+    ASSERT_EQ(devices.size(), 1u);
+    EXPECT_EQ(devices[0].name, "thermal-cpufreq-0");
+    EXPECT_EQ(devices[0].type, CoolingType::CPU);
+    EXPECT_EQ(devices[0].value, 2);
+}
+
+}  // namespace impl
+}  // namespace thermal
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
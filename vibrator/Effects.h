@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "Vibrator.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+constexpr size_t kNumEffects = static_cast<size_t>(Effect::TEXTURE_TICK) + 1;
+constexpr size_t kNumStrengths = static_cast<size_t>(EffectStrength::STRONG) + 1;
+
+struct EffectInfo {
+    // cp_trigger_index of the firmware preset, 0 if there is none
+    int32_t cpTrigger;
+    // How long to run the motor when playing without a preset, 0 if unsupported
+    uint32_t fallbackMs;
+    uint32_t intensity;
+};
+
+/*
+ * Per-device effect config, one line per effect with its amplitude for each
+ * EffectStrength. Effects that are not listed are unsupported.
+ */
+struct EffectConfig {
+    Effect effect;
+    int32_t cpTrigger;
+    uint32_t fallbackMs;
+    float amplitudes[kNumStrengths];
+};
+
+constexpr EffectConfig kEffectConfig[] = {
+    { Effect::CLICK, 10, 10, { AMPLITUDE_LIGHT, AMPLITUDE_MEDIUM, AMPLITUDE_STRONG } },
+    { Effect::DOUBLE_CLICK, 14, 0, { AMPLITUDE_LIGHT, AMPLITUDE_MEDIUM, AMPLITUDE_STRONG } },
+    { Effect::TICK, 50, 5, { AMPLITUDE_LIGHT, AMPLITUDE_MEDIUM, AMPLITUDE_STRONG } },
+    { Effect::THUD, 0, 40, { AMPLITUDE_MEDIUM, 0.75, AMPLITUDE_STRONG } },
+    { Effect::POP, 0, 15, { AMPLITUDE_LIGHT, AMPLITUDE_MEDIUM, 0.75 } },
+    { Effect::HEAVY_CLICK, 23, 15, { AMPLITUDE_MEDIUM, 0.75, AMPLITUDE_STRONG } },
+    { Effect::TEXTURE_TICK, 50, 5, { AMPLITUDE_LIGHT, AMPLITUDE_LIGHT, AMPLITUDE_MEDIUM } },
+};
+
+using EffectTable = std::array<std::array<EffectInfo, kNumStrengths>, kNumEffects>;
+
+constexpr EffectTable makeEffectTable() {
+    EffectTable table{};
+
+    for (const auto& config : kEffectConfig) {
+        for (size_t i = 0; i < kNumStrengths; i++) {
+            // activate() runs the motor for at least INTENSITY_MIN, so report that
+            uint32_t fallbackMs = config.fallbackMs == 0
+                    ? 0
+                    : std::max<uint32_t>(config.fallbackMs, INTENSITY_MIN);
+            table[static_cast<size_t>(config.effect)][i] = {
+                config.cpTrigger, fallbackMs,
+                static_cast<uint32_t>(config.amplitudes[i] * INTENSITY_MAX)};
+        }
+    }
+
+    return table;
+}
+
+// Indexed by Effect and EffectStrength
+constexpr EffectTable kEffects = makeEffectTable();
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
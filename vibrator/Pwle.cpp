@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "Pwle.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+static uint32_t amplitudeToIntensity(float amplitude) {
+    if (amplitude <= 0.0f)
+        return 0;
+
+    return std::max<uint32_t>(std::lround(amplitude * INTENSITY_MAX), INTENSITY_MIN);
+}
+
+// runStart is the index of the step that started the motor last
+static void appendStep(std::vector<PwleStep>* schedule, size_t* runStart, int64_t offsetMs,
+                       int64_t durationMs, uint32_t intensity) {
+    if (intensity == 0)
+        return;
+
+    if (!schedule->empty()) {
+        PwleStep& run = (*schedule)[*runStart];
+
+        // Extend the current run if it reaches this step
+        if (run.offsetMs + run.activateMs == offsetMs) {
+            run.activateMs += durationMs;
+            if (schedule->back().intensity != intensity)
+                schedule->push_back({offsetMs, intensity, 0});
+            return;
+        }
+    }
+
+    *runStart = schedule->size();
+    schedule->push_back({offsetMs, intensity, static_cast<uint32_t>(durationMs)});
+}
+
+bool buildPwleSchedule(const std::vector<PrimitivePwle>& composite,
+                       std::vector<PwleStep>* schedule, int64_t* durationMs) {
+    schedule->clear();
+    *durationMs = 0;
+
+    if (composite.empty() || composite.size() > kPwleSizeMax)
+        return false;
+
+    int64_t offsetMs = 0;
+    size_t runStart = 0;
+    for (const auto& pwle : composite) {
+        if (pwle.getTag() == PrimitivePwle::Tag::braking) {
+            const auto& braking = pwle.get<PrimitivePwle::Tag::braking>();
+            if (braking.braking != Braking::NONE || braking.duration < 0 ||
+                braking.duration > kPwlePrimitiveDurationMaxMs) {
+                return false;
+            }
+
+            offsetMs += braking.duration;
+            continue;
+        }
+
+        const auto& active = pwle.get<PrimitivePwle::Tag::active>();
+        if (active.startAmplitude < 0.0f || active.startAmplitude > 1.0f ||
+            active.endAmplitude < 0.0f || active.endAmplitude > 1.0f || active.duration < 0 ||
+            active.duration > kPwlePrimitiveDurationMaxMs) {
+            return false;
+        }
+
+        float slope = active.duration > 0
+                ? (active.endAmplitude - active.startAmplitude) / active.duration
+                : 0.0f;
+
+        for (int32_t t = 0; t < active.duration; t += kPwleStepMs) {
+            int32_t step = std::min(kPwleStepMs, active.duration - t);
+            float amplitude = active.startAmplitude + slope * (t + step / 2.0f);
+            appendStep(schedule, &runStart, offsetMs + t, step, amplitudeToIntensity(amplitude));
+        }
+
+        offsetMs += active.duration;
+    }
+
+    *durationMs = offsetMs;
+    return true;
+}
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
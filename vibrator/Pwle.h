@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Vibrator.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+constexpr int32_t kPwlePrimitiveDurationMaxMs = 1000;
+constexpr int32_t kPwleSizeMax = 16;
+// Period at which amplitude ramps are resampled into intensity writes
+constexpr int32_t kPwleStepMs = 10;
+
+struct PwleStep {
+    int64_t offsetMs;
+    uint32_t intensity;
+    // Starts the motor for this long, 0 to only change the intensity
+    uint32_t activateMs;
+};
+
+/*
+ * The motor has no frequency control, so a PWLE is emulated by its amplitude
+ * envelope alone: ramps are cut into kPwleStepMs steps, each played at the
+ * ramp's mean amplitude over that step. Only intensity changes end up in the
+ * schedule, and each stretch of non-zero amplitude starts with one activate
+ * covering all of it. Frequencies are ignored.
+ *
+ * Returns false if the composition is invalid. *durationMs is its total length.
+ */
+bool buildPwleSchedule(const std::vector<PrimitivePwle>& composite,
+                       std::vector<PwleStep>* schedule, int64_t* durationMs);
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
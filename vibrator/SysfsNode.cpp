@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SysfsNode.h"
+
+#include <android-base/logging.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <charconv>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+SysfsNode::SysfsNode(const char* path)
+    : mPath(path), mFd(open(path, O_WRONLY | O_CLOEXEC)) {
+    if (!mFd.ok()) {
+        PLOG(WARNING) << "Failed to open: " << path;
+    }
+}
+
+bool SysfsNode::write(int32_t value) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return writeLocked(value);
+}
+
+bool SysfsNode::writeIfChanged(int32_t value) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mHaveLast && mLast == value) return true;
+
+    return writeLocked(value);
+}
+
+void SysfsNode::invalidate() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHaveLast = false;
+}
+
+bool SysfsNode::writeLocked(int32_t value) {
+    char buf[16];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf) - 1, value);
+    *end++ = '\n';
+
+    if (pwrite(mFd.get(), buf, end - buf, 0) < 0) {
+        PLOG(ERROR) << "Failed to write " << value << " to " << mPath;
+        mHaveLast = false;
+        return false;
+    }
+
+    mHaveLast = true;
+    mLast = value;
+    return true;
+}
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+/*
+ * A sysfs attribute opened once for writing and kept open. Values are
+ * formatted on the stack and written with a single pwrite().
+ */
+class SysfsNode {
+public:
+    explicit SysfsNode(const char* path);
+
+    bool exists() const { return mFd.ok(); }
+
+    bool write(int32_t value);
+    // Skips the write when value is what the node was last set to
+    bool writeIfChanged(int32_t value);
+    // Forgets the last value, for when the driver may have reset the node
+    void invalidate();
+
+private:
+    bool writeLocked(int32_t value);
+
+    std::string mPath;
+    ::android::base::unique_fd mFd;
+
+    std::mutex mMutex;
+    bool mHaveLast{false};
+    int32_t mLast{0};
+};
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "TimerQueue.h"
+
+#include <android-base/logging.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+static constexpr int64_t kNsPerSec = 1000LL * 1000 * 1000;
+
+TimerQueue::TimerQueue()
+    : mTimerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)),
+      mEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+    if (!mTimerFd.ok() || !mEventFd.ok()) {
+        PLOG(ERROR) << "Failed to create timer queue fds";
+        return;
+    }
+
+    mThread = std::thread(&TimerQueue::run, this);
+}
+
+TimerQueue::~TimerQueue() {
+    if (!mThread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExit = true;
+    }
+    wake();
+    mThread.join();
+}
+
+int64_t TimerQueue::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * kNsPerSec + ts.tv_nsec;
+}
+
+uint64_t TimerQueue::newGeneration() {
+    // A task starting a new generation already holds the run lock
+    std::unique_lock<std::mutex> runLock(mRunMutex, std::defer_lock);
+    if (std::this_thread::get_id() != mThread.get_id()) runLock.lock();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mEntries.clear();
+    armTimerLocked();
+    return ++mGeneration;
+}
+
+void TimerQueue::schedule(uint64_t generation, int64_t deadlineNs, Task task) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (generation != mGeneration) return;
+
+    auto it = mEntries.emplace(deadlineNs, Entry{generation, std::move(task)});
+    if (it == mEntries.begin()) armTimerLocked();
+}
+
+void TimerQueue::wake() {
+    uint64_t one = 1;
+    write(mEventFd.get(), &one, sizeof(one));
+}
+
+/*
+ * The timerfd always tracks the earliest entry. A zero it_value disarms it,
+ * so deadlines that are already due are clamped to 1ns.
+ */
+void TimerQueue::armTimerLocked() {
+    int64_t deadline = mEntries.empty() ? 0 : std::max<int64_t>(mEntries.begin()->first, 1);
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = deadline / kNsPerSec;
+    spec.it_value.tv_nsec = deadline % kNsPerSec;
+
+    if (timerfd_settime(mTimerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        PLOG(ERROR) << "Failed to arm timer";
+    }
+}
+
+void TimerQueue::run() {
+    struct pollfd fds[] = {
+            {.fd = mTimerFd.get(), .events = POLLIN},
+            {.fd = mEventFd.get(), .events = POLLIN},
+    };
+    std::vector<Entry> due;
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            PLOG(ERROR) << "Failed to poll timer queue";
+            return;
+        }
+
+        uint64_t count;
+        read(mTimerFd.get(), &count, sizeof(count));
+        read(mEventFd.get(), &count, sizeof(count));
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mExit) return;
+
+            int64_t now = TimerQueue::now();
+            auto end = mEntries.upper_bound(now);
+            for (auto it = mEntries.begin(); it != end; ++it) {
+                due.push_back(std::move(it->second));
+            }
+            mEntries.erase(mEntries.begin(), end);
+            armTimerLocked();
+        }
+
+        /*
+         * Tasks may schedule more work, so they run without the lock held.
+         * Re-check the generation under the run lock, it could have moved on
+         * in the meantime but cannot while the task runs.
+         */
+        for (auto& entry : due) {
+            std::lock_guard<std::mutex> runLock(mRunMutex);
+            if (entry.generation == mGeneration) entry.task();
+        }
+        due.clear();
+    }
+}
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
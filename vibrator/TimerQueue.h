@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+/*
+ * Runs delayed tasks on a single thread driven by a CLOCK_MONOTONIC timerfd.
+ *
+ * Every task belongs to a generation. Starting a new generation drops all
+ * tasks of older ones, so a new vibration or off() supersedes whatever the
+ * previous vibration still had pending, including its completion callback.
+ */
+class TimerQueue {
+public:
+    using Task = std::function<void()>;
+
+    TimerQueue();
+    ~TimerQueue();
+
+    /*
+     * Cancels everything pending and returns the id of the new generation.
+     * A task that is running finishes first, so once this returns no task of
+     * an older generation runs anymore.
+     */
+    uint64_t newGeneration();
+    // Runs task at deadlineNs unless its generation has been superseded by then
+    void schedule(uint64_t generation, int64_t deadlineNs, Task task);
+
+    static int64_t now();
+
+private:
+    struct Entry {
+        uint64_t generation;
+        Task task;
+    };
+
+    void run();
+    void wake();
+    void armTimerLocked();
+
+    ::android::base::unique_fd mTimerFd;
+    ::android::base::unique_fd mEventFd;
+
+    // Held while a task runs, so newGeneration() can wait it out
+    std::mutex mRunMutex;
+
+    std::mutex mMutex;
+    // Keyed by deadline
+    std::multimap<int64_t, Entry> mEntries;
+    std::atomic<uint64_t> mGeneration{0};
+    bool mExit{false};
+
+    std::thread mThread;
+};
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
@@ -5,140 +5,182 @@
  */
 
 #include "Vibrator.h"
+#include "Effects.h"
+#include "Pwle.h"
 
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 
+#include <algorithm>
 #include <cmath>
-#include <fstream>
-#include <iostream>
-#include <map>
-#include <thread>
+#include <iterator>
 
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace vibrator {
 
-static std::map<Effect, int> CP_TRIGGER_EFFECTS {
-    { Effect::CLICK, 10 },
-    { Effect::DOUBLE_CLICK, 14 },
-    { Effect::HEAVY_CLICK, 23 },
-    { Effect::TEXTURE_TICK, 50 },
-    { Effect::TICK, 50 }
+static constexpr int64_t kNsPerMs = 1000 * 1000;
+
+static constexpr char kExternalControlProp[] = "vendor.vibrator.external_control";
+
+// Timeout for firmware presets, which end on their own
+static constexpr uint32_t kCpTriggerTimeoutMs = 1000;
+
+// The driver has one cp_trigger_index, so there is one always-on slot
+static constexpr int32_t kAlwaysOnId = 0;
+
+static constexpr int32_t kComposeDelayMaxMs = 1000;
+static constexpr int32_t kComposeSizeMax = 256;
+
+struct PrimitiveInfo {
+    bool supported;
+    // cp_trigger effect to play, 0 for a plain timed vibration
+    int32_t cpTrigger;
+    uint32_t durationMs;
 };
 
 /*
- * Write value to path and close file.
+ * Indexed by CompositePrimitive. The durations are what the motor actually
+ * runs for, which is never below the 30ms activate() enforces.
  */
-template <typename T>
-static ndk::ScopedAStatus writeNode(const std::string& path, const T& value) {
-    std::ofstream node(path);
-    if (!node) {
-        LOG(ERROR) << "Failed to open: " << path;
-        return ndk::ScopedAStatus::fromStatus(STATUS_UNKNOWN_ERROR);
-    }
+static constexpr PrimitiveInfo PRIMITIVES[] = {
+    /* NOOP */ { true, 0, 0 },
+    /* CLICK */ { true, 10, 30 },
+    /* THUD */ { true, 23, 40 },
+    /* SPIN */ { false, 0, 0 },
+    /* QUICK_RISE */ { false, 0, 0 },
+    /* SLOW_RISE */ { false, 0, 0 },
+    /* QUICK_FALL */ { false, 0, 0 },
+    /* LIGHT_TICK */ { true, 50, 30 },
+    /* LOW_TICK */ { true, 0, 30 },
+};
 
-    LOG(DEBUG) << "writeNode node: " << path << " value: " << value;
+static const EffectInfo* effectInfo(Effect effect, EffectStrength strength) {
+    size_t e = static_cast<size_t>(effect);
+    size_t st = static_cast<size_t>(strength);
+    if (e >= kNumEffects || st >= kNumStrengths)
+        return nullptr;
 
-    node << value << std::endl;
-    if (!node) {
-        LOG(ERROR) << "Failed to write: " << value;
-        return ndk::ScopedAStatus::fromStatus(STATUS_UNKNOWN_ERROR);
-    }
+    return &kEffects[e][st];
+}
 
-    return ndk::ScopedAStatus::ok();
+bool Vibrator::isSupported(const EffectInfo& info) const {
+    return (mHasTimedOutEffect && info.cpTrigger != 0) || info.fallbackMs > 0;
 }
 
-static bool nodeExists(const std::string& path) {
-    std::ofstream f(path.c_str());
-    return f.good();
+static const PrimitiveInfo* primitiveInfo(CompositePrimitive primitive) {
+    size_t index = static_cast<size_t>(primitive);
+    if (index >= std::size(PRIMITIVES) || !PRIMITIVES[index].supported)
+        return nullptr;
+
+    return &PRIMITIVES[index];
+}
+
+static void notifyComplete(const std::shared_ptr<IVibratorCallback>& callback) {
+    LOG(DEBUG) << "Notifying complete";
+    if (!callback->onComplete().isOk()) {
+        LOG(ERROR) << "Failed to call onComplete";
+    }
 }
 
-Vibrator::Vibrator() {
-    mIsTimedOutVibrator = nodeExists(VIBRATOR_TIMEOUT_PATH);
-    mHasTimedOutIntensity = nodeExists(VIBRATOR_INTENSITY_PATH);
-    mHasTimedOutEffect = nodeExists(VIBRATOR_CP_TRIGGER_PATH);
+static ndk::ScopedAStatus toStatus(bool written) {
+    return written ? ndk::ScopedAStatus::ok()
+                   : ndk::ScopedAStatus::fromStatus(STATUS_UNKNOWN_ERROR);
+}
+
+Vibrator::Vibrator()
+    : Vibrator(VIBRATOR_TIMEOUT_PATH, VIBRATOR_INTENSITY_PATH, VIBRATOR_CP_TRIGGER_PATH) {}
+
+Vibrator::Vibrator(const char* timeoutPath, const char* intensityPath, const char* cpTriggerPath)
+    : mTimeoutNode(timeoutPath),
+      mIntensityNode(intensityPath),
+      mCpTriggerNode(cpTriggerPath) {
+    mIsTimedOutVibrator = mTimeoutNode.exists();
+    mHasTimedOutIntensity = mIntensityNode.exists();
+    mHasTimedOutEffect = mCpTriggerNode.exists();
 }
 
 ndk::ScopedAStatus Vibrator::getCapabilities(int32_t* _aidl_return) {
     *_aidl_return = IVibrator::CAP_ON_CALLBACK | IVibrator::CAP_PERFORM_CALLBACK |
-                    IVibrator::CAP_EXTERNAL_CONTROL /*| IVibrator::CAP_COMPOSE_EFFECTS |
-                    IVibrator::CAP_ALWAYS_ON_CONTROL*/;
+                    IVibrator::CAP_EXTERNAL_CONTROL;
+
+    if (mIsTimedOutVibrator) {
+        *_aidl_return = *_aidl_return | IVibrator::CAP_COMPOSE_EFFECTS;
+    }
+
+    if (mHasTimedOutEffect) {
+        *_aidl_return = *_aidl_return | IVibrator::CAP_ALWAYS_ON_CONTROL;
+    }
 
     if (mHasTimedOutIntensity) {
         *_aidl_return = *_aidl_return | IVibrator::CAP_AMPLITUDE_CONTROL |
                         IVibrator::CAP_EXTERNAL_AMPLITUDE_CONTROL;
     }
 
+    // Emulated through the intensity node, without any frequency control
+    if (mIsTimedOutVibrator && mHasTimedOutIntensity) {
+        *_aidl_return = *_aidl_return | IVibrator::CAP_COMPOSE_PWLE_EFFECTS;
+    }
+
     return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus Vibrator::off() {
-    return activate(0);
+    mTimers.newGeneration();
+    ndk::ScopedAStatus status = activate(0);
+    rearmAlwaysOn();
+
+    return status;
 }
 
 ndk::ScopedAStatus Vibrator::on(int32_t timeoutMs, const std::shared_ptr<IVibratorCallback>& callback) {
     ndk::ScopedAStatus status;
+    uint64_t generation = mTimers.newGeneration();
 
     if (mHasTimedOutEffect)
-        writeNode(VIBRATOR_CP_TRIGGER_PATH, 0); // Clear all effects
+        mCpTriggerNode.writeIfChanged(0); // Clear all effects
 
-    status = activate(timeoutMs);
-
-    if (callback != nullptr) {
-        std::thread([=] {
-            LOG(DEBUG) << "Starting on on another thread";
-            usleep(timeoutMs * 1000);
-            LOG(DEBUG) << "Notifying on complete";
-            if (!callback->onComplete().isOk()) {
-                LOG(ERROR) << "Failed to call onComplete";
-            }
-        }).detach();
+    // Effects and the always-on re-arm leave their own intensity in the node
+    if (mHasTimedOutIntensity) {
+        uint32_t intensity;
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            intensity = mAmplitudeIntensity;
+        }
+        mIntensityNode.writeIfChanged(intensity);
     }
 
+    status = activate(timeoutMs);
+    finishAt(generation, TimerQueue::now() + timeoutMs * kNsPerMs, callback);
+
     return status;
 }
 
 ndk::ScopedAStatus Vibrator::perform(Effect effect, EffectStrength strength, const std::shared_ptr<IVibratorCallback>& callback, int32_t* _aidl_return) {
-    ndk::ScopedAStatus status;
-    float amplitude = strengthToAmplitude(strength, &status);
-    uint32_t ms = 1000;
-
-    if (!status.isOk())
-        return status;
-
-    activate(0);
-    setAmplitude(amplitude);
-
-    if (mHasTimedOutEffect && CP_TRIGGER_EFFECTS.find(effect) != CP_TRIGGER_EFFECTS.end()) {
-        writeNode(VIBRATOR_CP_TRIGGER_PATH, CP_TRIGGER_EFFECTS[effect]);
-    } else {
-        if (mHasTimedOutEffect)
-            writeNode(VIBRATOR_CP_TRIGGER_PATH, 0); // Clear previous effect
-
-        ms = effectToMs(effect, &status);
-
-        if (!status.isOk())
-            return status;
-    }
+    const EffectInfo* info = effectInfo(effect, strength);
+    if (info == nullptr || !isSupported(*info))
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
 
-    status = activate(ms);
+    bool usePreset = mHasTimedOutEffect && info->cpTrigger != 0;
+    uint32_t ms = usePreset ? kCpTriggerTimeoutMs : info->fallbackMs;
 
-    if (callback != nullptr) {
-        std::thread([=] {
-            LOG(DEBUG) << "Starting perform on another thread";
-            usleep(ms * 1000);
-            LOG(DEBUG) << "Notifying perform complete";
-            callback->onComplete();
-        }).detach();
-    }
+    uint64_t generation = mTimers.newGeneration();
+    ndk::ScopedAStatus status = play(usePreset ? info->cpTrigger : 0, info->intensity, ms);
+    finishAt(generation, TimerQueue::now() + ms * kNsPerMs, callback);
 
     *_aidl_return = ms;
     return status;
 }
 
 ndk::ScopedAStatus Vibrator::getSupportedEffects(std::vector<Effect>* _aidl_return) {
-    *_aidl_return = { Effect::CLICK, Effect::TICK };
+    _aidl_return->clear();
+    for (size_t i = 0; i < kNumEffects; i++) {
+        // Every strength of an effect shares its trigger and duration
+        if (isSupported(kEffects[i][0]))
+            _aidl_return->push_back(static_cast<Effect>(i));
+    }
+
     return ndk::ScopedAStatus::ok();
 }
 
@@ -155,8 +197,13 @@ ndk::ScopedAStatus Vibrator::setAmplitude(float amplitude) {
 
     LOG(DEBUG) << "Setting intensity: " << intensity;
 
-    if (mIsTimedOutVibrator) {
-        return writeNode(VIBRATOR_TIMEOUT_PATH, intensity);
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mAmplitudeIntensity = intensity;
+    }
+
+    if (mHasTimedOutIntensity) {
+        return toStatus(mIntensityNode.writeIfChanged(intensity));
     }
 
     return ndk::ScopedAStatus::ok();
@@ -169,41 +216,157 @@ ndk::ScopedAStatus Vibrator::setExternalControl(bool enabled) {
         return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
     }
 
-    LOG(INFO) << "ExternalControl: " << mExternalControl << " -> " << enabled;
-    mExternalControl = enabled;
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        LOG(INFO) << "ExternalControl: " << mExternalControl << " -> " << enabled;
+        mExternalControl = enabled;
+    }
+
+    // Haptic-capable audio streams drive the motor from the audio HAL while this is set
+    if (enabled) {
+        // Stop without re-arming, the always-on effect would fire on audio's writes
+        mTimers.newGeneration();
+        activate(0);
+        if (mHasTimedOutEffect)
+            mCpTriggerNode.writeIfChanged(0);
+
+        ::android::base::SetProperty(kExternalControlProp, "1");
+        return ndk::ScopedAStatus::ok();
+    }
+
+    ::android::base::SetProperty(kExternalControlProp, "0");
+
+    // The audio HAL wrote these nodes behind our back
+    mTimeoutNode.invalidate();
+    mIntensityNode.invalidate();
+    mCpTriggerNode.invalidate();
+    rearmAlwaysOn();
+
     return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getCompositionDelayMax(int32_t* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getCompositionDelayMax(int32_t* _aidl_return) {
+    *_aidl_return = kComposeDelayMaxMs;
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getCompositionSizeMax(int32_t* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getCompositionSizeMax(int32_t* _aidl_return) {
+    *_aidl_return = kComposeSizeMax;
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getSupportedPrimitives(std::vector<CompositePrimitive>* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getSupportedPrimitives(std::vector<CompositePrimitive>* _aidl_return) {
+    _aidl_return->clear();
+    for (size_t i = 0; i < std::size(PRIMITIVES); i++) {
+        if (PRIMITIVES[i].supported)
+            _aidl_return->push_back(static_cast<CompositePrimitive>(i));
+    }
+
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getPrimitiveDuration(CompositePrimitive /*primitive*/, int32_t* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getPrimitiveDuration(CompositePrimitive primitive, int32_t* _aidl_return) {
+    const PrimitiveInfo* info = primitiveInfo(primitive);
+    if (info == nullptr)
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+
+    *_aidl_return = info->durationMs;
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::compose(const std::vector<CompositeEffect>& /*composite*/, const std::shared_ptr<IVibratorCallback>& /*callback*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+/*
+ * The whole composition is validated and then laid out on the timer queue
+ * up front: one task per primitive at its offset from now, and one for the
+ * completion callback after the last primitive has finished.
+ */
+ndk::ScopedAStatus Vibrator::compose(const std::vector<CompositeEffect>& composite, const std::shared_ptr<IVibratorCallback>& callback) {
+    if (!mIsTimedOutVibrator)
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+
+    if (composite.size() > kComposeSizeMax)
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+
+    for (const auto& e : composite) {
+        if (e.delayMs < 0 || e.delayMs > kComposeDelayMaxMs || e.scale < 0.0f ||
+            e.scale > 1.0f || primitiveInfo(e.primitive) == nullptr) {
+            return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+        }
+    }
+
+    uint64_t generation = mTimers.newGeneration();
+    activate(0);
+
+    int64_t deadlineNs = TimerQueue::now();
+    for (const auto& e : composite) {
+        const PrimitiveInfo* info = primitiveInfo(e.primitive);
+        deadlineNs += e.delayMs * kNsPerMs;
+
+        if (info->durationMs > 0 && e.scale > 0.0f) {
+            uint32_t intensity = std::max<uint32_t>(e.scale * INTENSITY_MAX, INTENSITY_MIN);
+            mTimers.schedule(generation, deadlineNs, [this, info, intensity] {
+                play(info->cpTrigger, intensity, info->durationMs);
+            });
+        }
+
+        deadlineNs += info->durationMs * kNsPerMs;
+    }
+
+    finishAt(generation, deadlineNs, callback);
+
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getSupportedAlwaysOnEffects(std::vector<Effect>* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getSupportedAlwaysOnEffects(std::vector<Effect>* _aidl_return) {
+    _aidl_return->clear();
+    for (size_t i = 0; i < kNumEffects; i++) {
+        if (kEffects[i][0].cpTrigger != 0)
+            _aidl_return->push_back(static_cast<Effect>(i));
+    }
+
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::alwaysOnEnable(int32_t /*id*/, Effect /*effect*/, EffectStrength /*strength*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+/*
+ * The driver has a single cp_trigger_index, which the IC plays on its own
+ * when the motor is fired without a new effect being selected. So there is
+ * one always-on slot, and the HAL puts its effect back into the node every
+ * time a vibration of its own has overwritten it.
+ */
+ndk::ScopedAStatus Vibrator::alwaysOnEnable(int32_t id, Effect effect, EffectStrength strength) {
+    if (!mHasTimedOutEffect)
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+
+    if (id != kAlwaysOnId)
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+
+    const EffectInfo* info = effectInfo(effect, strength);
+    if (info == nullptr || info->cpTrigger == 0)
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mAlwaysOnTrigger = info->cpTrigger;
+        mAlwaysOnIntensity = info->intensity;
+    }
+
+    rearmAlwaysOn();
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::alwaysOnDisable(int32_t /*id*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::alwaysOnDisable(int32_t id) {
+    if (!mHasTimedOutEffect)
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+
+    if (id != kAlwaysOnId)
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mAlwaysOnTrigger = 0;
+    }
+
+    mCpTriggerNode.writeIfChanged(0);
+    return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus Vibrator::getResonantFrequency(float* /*_aidl_return*/) {
@@ -226,20 +389,43 @@ ndk::ScopedAStatus Vibrator::getBandwidthAmplitudeMap(std::vector<float>* /*_aid
     return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
 }
 
-ndk::ScopedAStatus Vibrator::getPwlePrimitiveDurationMax(int32_t* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getPwlePrimitiveDurationMax(int32_t* _aidl_return) {
+    *_aidl_return = kPwlePrimitiveDurationMaxMs;
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getPwleCompositionSizeMax(int32_t* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getPwleCompositionSizeMax(int32_t* _aidl_return) {
+    *_aidl_return = kPwleSizeMax;
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::getSupportedBraking(std::vector<Braking>* /*_aidl_return*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Vibrator::getSupportedBraking(std::vector<Braking>* _aidl_return) {
+    *_aidl_return = { Braking::NONE };
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Vibrator::composePwle(const std::vector<PrimitivePwle>& /*composite*/, const std::shared_ptr<IVibratorCallback>& /*callback*/) {
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+/*
+ * The schedule is built up front and then walked one step at a time on the
+ * timer queue, each step scheduling the next.
+ */
+ndk::ScopedAStatus Vibrator::composePwle(const std::vector<PrimitivePwle>& composite, const std::shared_ptr<IVibratorCallback>& callback) {
+    if (!mIsTimedOutVibrator || !mHasTimedOutIntensity)
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+
+    auto schedule = std::make_shared<std::vector<PwleStep>>();
+    int64_t durationMs;
+    if (!buildPwleSchedule(composite, schedule.get(), &durationMs))
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+
+    uint64_t generation = mTimers.newGeneration();
+    activate(0);
+
+    int64_t startNs = TimerQueue::now();
+    if (!schedule->empty())
+        schedulePwleStep(generation, startNs, std::move(schedule), 0);
+
+    finishAt(generation, startNs + durationMs * kNsPerMs, callback);
+    return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus Vibrator::activate(uint32_t timeoutMs) {
@@ -250,42 +436,72 @@ ndk::ScopedAStatus Vibrator::activate(uint32_t timeoutMs) {
 
     /* We mostly get values that are 20ms and lower, but
        that's not enough to be actually noticeable. Set it to
-       30ms if timeoutMs is less than that. */
-    if (timeoutMs < INTENSITY_MIN) {
+       30ms if timeoutMs is less than that. 0 stops the motor. */
+    if (timeoutMs > 0 && timeoutMs < INTENSITY_MIN) {
         timeoutMs = INTENSITY_MIN;
     }
 
-    return writeNode(VIBRATOR_TIMEOUT_PATH, timeoutMs);
+    return toStatus(mTimeoutNode.write(timeoutMs));
 }
 
-float Vibrator::strengthToAmplitude(EffectStrength strength, ndk::ScopedAStatus* status) {
-    *status = ndk::ScopedAStatus::ok();
+void Vibrator::finishAt(uint64_t generation, int64_t deadlineNs,
+                        const std::shared_ptr<IVibratorCallback>& callback) {
+    mTimers.schedule(generation, deadlineNs, [this, callback] {
+        rearmAlwaysOn();
+        if (callback != nullptr)
+            notifyComplete(callback);
+    });
+}
+
+void Vibrator::rearmAlwaysOn() {
+    int32_t cpTrigger;
+    uint32_t intensity;
 
-    switch (strength) {
-        case EffectStrength::LIGHT:
-            return AMPLITUDE_LIGHT;
-        case EffectStrength::MEDIUM:
-            return AMPLITUDE_MEDIUM;
-        case EffectStrength::STRONG:
-            return AMPLITUDE_STRONG;
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        if (mExternalControl)
+            return;
+
+        cpTrigger = mAlwaysOnTrigger;
+        intensity = mAlwaysOnIntensity;
     }
 
-    *status = ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
-    return 0;
+    if (cpTrigger == 0)
+        return;
+
+    if (mHasTimedOutIntensity)
+        mIntensityNode.writeIfChanged(intensity);
+
+    mCpTriggerNode.writeIfChanged(cpTrigger);
 }
 
-uint32_t Vibrator::effectToMs(Effect effect, ndk::ScopedAStatus* status) {
-    *status = ndk::ScopedAStatus::ok();
-    switch (effect) {
-        case Effect::CLICK:
-            return 10;
-        case Effect::TICK:
-            return 5;
-        default:
-            break;
-    }
-    *status = ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
-    return 0;
+void Vibrator::schedulePwleStep(uint64_t generation, int64_t startNs,
+                                std::shared_ptr<std::vector<PwleStep>> schedule, size_t index) {
+    int64_t deadlineNs = startNs + (*schedule)[index].offsetMs * kNsPerMs;
+
+    mTimers.schedule(generation, deadlineNs, [this, generation, startNs, schedule, index] {
+        const PwleStep& step = (*schedule)[index];
+
+        if (step.activateMs > 0)
+            play(0, step.intensity, step.activateMs);
+        else
+            mIntensityNode.writeIfChanged(step.intensity);
+
+        if (index + 1 < schedule->size())
+            schedulePwleStep(generation, startNs, schedule, index + 1);
+    });
+}
+
+ndk::ScopedAStatus Vibrator::play(int32_t cpTrigger, uint32_t intensity, uint32_t ms) {
+    activate(0);
+
+    if (mHasTimedOutIntensity)
+        mIntensityNode.writeIfChanged(intensity);
+
+    if (mHasTimedOutEffect)
+        mCpTriggerNode.writeIfChanged(cpTrigger);
+
+    return activate(ms);
 }
 
 } // namespace vibrator
@@ -8,6 +8,9 @@
 
 #include <aidl/android/hardware/vibrator/BnVibrator.h>
 
+#include "SysfsNode.h"
+#include "TimerQueue.h"
+
 #define INTENSITY_MIN 30
 #define INTENSITY_MAX 10000
 #define INTENSITY_DEFAULT INTENSITY_MAX
@@ -33,9 +36,14 @@ namespace android {
 namespace hardware {
 namespace vibrator {
 
+struct EffectInfo;
+struct PwleStep;
+
 class Vibrator : public BnVibrator {
 public:
     Vibrator();
+    // Takes other node paths, e.g. to run against fake nodes off-device
+    Vibrator(const char* timeoutPath, const char* intensityPath, const char* cpTriggerPath);
     ndk::ScopedAStatus getCapabilities(int32_t* _aidl_return) override;
     ndk::ScopedAStatus off() override;
     ndk::ScopedAStatus on(int32_t timeoutMs, const std::shared_ptr<IVibratorCallback>& callback) override;
@@ -63,16 +71,38 @@ public:
 
 private:
     ndk::ScopedAStatus activate(uint32_t ms);
-    static uint32_t effectToMs(Effect effect, ndk::ScopedAStatus* status);
-    static float strengthToAmplitude(EffectStrength strength, ndk::ScopedAStatus* status);
+    // Plays a cp_trigger effect, or a plain timed vibration if cpTrigger is 0
+    ndk::ScopedAStatus play(int32_t cpTrigger, uint32_t intensity, uint32_t ms);
+    // Re-arms the always-on effect and notifies callback once the vibration is over
+    void finishAt(uint64_t generation, int64_t deadlineNs,
+                  const std::shared_ptr<IVibratorCallback>& callback);
+    void rearmAlwaysOn();
+    void schedulePwleStep(uint64_t generation, int64_t startNs,
+                          std::shared_ptr<std::vector<PwleStep>> schedule, size_t index);
+    // Whether an effect can be played, with or without its firmware preset
+    bool isSupported(const EffectInfo& info) const;
 
     bool mEnabled{false};
-    bool mExternalControl{false};
     std::mutex mMutex;
+    // Guarded by mMutex, the always-on effect stays disarmed while it is set
+    bool mExternalControl{false};
+
+    SysfsNode mTimeoutNode;
+    SysfsNode mIntensityNode;
+    SysfsNode mCpTriggerNode;
 
     bool mIsTimedOutVibrator;
     bool mHasTimedOutIntensity;
     bool mHasTimedOutEffect;
+
+    // Guarded by mMutex, a cp_trigger index of 0 means disabled
+    int32_t mAlwaysOnTrigger{0};
+    uint32_t mAlwaysOnIntensity{INTENSITY_DEFAULT};
+    // Guarded by mMutex, the last setAmplitude(), which on() plays at
+    uint32_t mAmplitudeIntensity{INTENSITY_DEFAULT};
+
+    // Completion callbacks and composition steps of the current vibration
+    TimerQueue mTimers;
 };
 
 } // namespace vibrator
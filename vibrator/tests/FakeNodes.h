@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/file.h>
+
+#include <memory>
+#include <string>
+
+#include "Vibrator.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+// Plain files standing in for the timed_output nodes
+class FakeNodes {
+public:
+    FakeNodes()
+        : mTimeout(std::string(mDir.path) + "/enable"),
+          mIntensity(std::string(mDir.path) + "/intensity"),
+          mCpTrigger(std::string(mDir.path) + "/cp_trigger_index") {
+        for (const auto& path : {mTimeout, mIntensity, mCpTrigger}) {
+            ::android::base::WriteStringToFile("0\n", path);
+        }
+    }
+
+    std::shared_ptr<Vibrator> makeVibrator() const {
+        return ndk::SharedRefBase::make<Vibrator>(mTimeout.c_str(), mIntensity.c_str(),
+                                                  mCpTrigger.c_str());
+    }
+
+    const std::string& timeout() const { return mTimeout; }
+
+    // The last value written to a node, without the newline
+    static std::string read(const std::string& path) {
+        std::string value;
+        ::android::base::ReadFileToString(path, &value);
+        return value.substr(0, value.find('\n'));
+    }
+
+    std::string timeoutValue() const { return read(mTimeout); }
+    std::string intensityValue() const { return read(mIntensity); }
+    std::string cpTriggerValue() const { return read(mCpTrigger); }
+
+    // Writes behind the HAL's back, as the audio HAL does under external control
+    void setIntensity(const std::string& value) const {
+        ::android::base::WriteStringToFile(value + "\n", mIntensity);
+    }
+
+private:
+    TemporaryDir mDir;
+    std::string mTimeout;
+    std::string mIntensity;
+    std::string mCpTrigger;
+};
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "Pwle.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+static PrimitivePwle active(float startAmplitude, float endAmplitude, int32_t duration) {
+    ActivePwle pwle;
+    pwle.startAmplitude = startAmplitude;
+    pwle.startFrequency = 150.0f;
+    pwle.endAmplitude = endAmplitude;
+    pwle.endFrequency = 150.0f;
+    pwle.duration = duration;
+    return PrimitivePwle::make<PrimitivePwle::Tag::active>(pwle);
+}
+
+static PrimitivePwle braking(int32_t duration) {
+    BrakingPwle pwle;
+    pwle.braking = Braking::NONE;
+    pwle.duration = duration;
+    return PrimitivePwle::make<PrimitivePwle::Tag::braking>(pwle);
+}
+
+// Intensity the motor is at offsetMs into the schedule, 0 when it is stopped
+static uint32_t intensityAt(const std::vector<PwleStep>& schedule, int64_t offsetMs) {
+    uint32_t intensity = 0;
+    int64_t activeUntilMs = 0;
+
+    for (const auto& step : schedule) {
+        if (step.offsetMs > offsetMs)
+            break;
+        if (step.activateMs > 0)
+            activeUntilMs = step.offsetMs + step.activateMs;
+        intensity = step.intensity;
+    }
+
+    return offsetMs < activeUntilMs ? intensity : 0;
+}
+
+// Amplitude of the envelope at t, braking counts as silence
+static float envelopeAt(const std::vector<PrimitivePwle>& composite, float t) {
+    for (const auto& pwle : composite) {
+        if (pwle.getTag() == PrimitivePwle::Tag::braking) {
+            const auto& braking = pwle.get<PrimitivePwle::Tag::braking>();
+            if (t < braking.duration)
+                return 0.0f;
+            t -= braking.duration;
+            continue;
+        }
+
+        const auto& active = pwle.get<PrimitivePwle::Tag::active>();
+        if (t < active.duration) {
+            return active.startAmplitude +
+                   (active.endAmplitude - active.startAmplitude) * t / active.duration;
+        }
+        t -= active.duration;
+    }
+
+    return 0.0f;
+}
+
+TEST(PwleTest, ScheduleFollowsEnvelope) {
+    const std::vector<PrimitivePwle> composite = {
+            active(0.0f, 1.0f, 50), active(1.0f, 1.0f, 30), braking(20), active(0.5f, 0.0f, 25),
+    };
+
+    std::vector<PwleStep> schedule;
+    int64_t durationMs;
+    ASSERT_TRUE(buildPwleSchedule(composite, &schedule, &durationMs));
+    EXPECT_EQ(durationMs, 125);
+
+    for (int64_t t = 0; t < durationMs; t++) {
+        float amplitude = envelopeAt(composite, t + 0.5f);
+        uint32_t intensity = intensityAt(schedule, t);
+
+        if (amplitude == 0.0f) {
+            EXPECT_EQ(intensity, 0u) << "at " << t << "ms";
+            continue;
+        }
+
+        // Each step plays the mean of its ramp, so it is off by half a step of the steepest
+        // ramp at most, which covers 1.0 over 50ms
+        float slopePerStep = 1.0f / 50 * kPwleStepMs;
+        EXPECT_NEAR(intensity, std::max<float>(amplitude * INTENSITY_MAX, INTENSITY_MIN),
+                    slopePerStep / 2 * INTENSITY_MAX + 1)
+                << "at " << t << "ms";
+    }
+}
+
+TEST(PwleTest, ActivatesOncePerRun) {
+    std::vector<PwleStep> schedule;
+    int64_t durationMs;
+    ASSERT_TRUE(buildPwleSchedule({active(0.2f, 1.0f, 100), braking(30), active(1.0f, 1.0f, 40)},
+                                  &schedule, &durationMs));
+
+    std::vector<PwleStep> activates;
+    for (const auto& step : schedule) {
+        if (step.activateMs > 0)
+            activates.push_back(step);
+    }
+
+    ASSERT_EQ(activates.size(), 2u);
+    EXPECT_EQ(activates[0].offsetMs, 0);
+    EXPECT_EQ(activates[0].activateMs, 100u);
+    EXPECT_EQ(activates[1].offsetMs, 130);
+    EXPECT_EQ(activates[1].activateMs, 40u);
+}
+
+TEST(PwleTest, SkipsUnchangedIntensities) {
+    std::vector<PwleStep> schedule;
+    int64_t durationMs;
+    ASSERT_TRUE(buildPwleSchedule({active(0.5f, 0.5f, 200)}, &schedule, &durationMs));
+
+    ASSERT_EQ(schedule.size(), 1u);
+    EXPECT_EQ(schedule[0].intensity, INTENSITY_MAX / 2u);
+    EXPECT_EQ(schedule[0].activateMs, 200u);
+}
+
+TEST(PwleTest, RejectsInvalidCompositions) {
+    std::vector<PwleStep> schedule;
+    int64_t durationMs;
+
+    EXPECT_FALSE(buildPwleSchedule({}, &schedule, &durationMs));
+    EXPECT_FALSE(buildPwleSchedule({active(0.0f, 1.5f, 10)}, &schedule, &durationMs));
+    EXPECT_FALSE(buildPwleSchedule({active(0.0f, 1.0f, kPwlePrimitiveDurationMaxMs + 1)},
+                                   &schedule, &durationMs));
+    EXPECT_FALSE(buildPwleSchedule(std::vector<PrimitivePwle>(kPwleSizeMax + 1, braking(10)),
+                                   &schedule, &durationMs));
+}
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+#include <dirent.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "TimerQueue.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+static constexpr int64_t kNsPerMs = 1000 * 1000;
+
+static size_t threadCount() {
+    size_t count = 0;
+    DIR* dir = opendir("/proc/self/task");
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+// Collects what ran and when, tasks run on the queue thread
+class Recorder {
+public:
+    void record(int id) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRuns.push_back({id, TimerQueue::now()});
+        mCv.notify_all();
+    }
+
+    bool waitForRuns(size_t count, std::chrono::milliseconds timeout = std::chrono::seconds(1)) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mCv.wait_for(lock, timeout, [&] { return mRuns.size() >= count; });
+    }
+
+    std::vector<std::pair<int, int64_t>> runs() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mRuns;
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    std::vector<std::pair<int, int64_t>> mRuns;
+};
+
+TEST(TimerQueueTest, RunsTasksInDeadlineOrderOnTime) {
+    TimerQueue queue;
+    Recorder recorder;
+    uint64_t generation = queue.newGeneration();
+    int64_t start = TimerQueue::now();
+
+    for (int id : {3, 1, 2}) {
+        queue.schedule(generation, start + id * 10 * kNsPerMs, [&recorder, id] {
+            recorder.record(id);
+        });
+    }
+    ASSERT_TRUE(recorder.waitForRuns(3));
+
+    auto runs = recorder.runs();
+    for (int i = 0; i < 3; i++) {
+        int64_t deadline = start + (i + 1) * 10 * kNsPerMs;
+        EXPECT_EQ(runs[i].first, i + 1);
+        EXPECT_GE(runs[i].second, deadline);
+        EXPECT_LT(runs[i].second, deadline + 10 * kNsPerMs);
+    }
+}
+
+TEST(TimerQueueTest, NewGenerationDropsPendingTasks) {
+    TimerQueue queue;
+    Recorder recorder;
+    uint64_t old = queue.newGeneration();
+    int64_t start = TimerQueue::now();
+
+    queue.schedule(old, start + 10 * kNsPerMs, [&] { recorder.record(1); });
+    uint64_t generation = queue.newGeneration();
+    // Scheduling into a superseded generation is a no-op
+    queue.schedule(old, start + 10 * kNsPerMs, [&] { recorder.record(2); });
+    queue.schedule(generation, start + 20 * kNsPerMs, [&] { recorder.record(3); });
+
+    ASSERT_TRUE(recorder.waitForRuns(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto runs = recorder.runs();
+    ASSERT_EQ(runs.size(), 1u);
+    EXPECT_EQ(runs[0].first, 3);
+}
+
+TEST(TimerQueueTest, NewGenerationWaitsForRunningTask) {
+    TimerQueue queue;
+    std::atomic<bool> started{false};
+    std::atomic<bool> finished{false};
+    uint64_t generation = queue.newGeneration();
+
+    queue.schedule(generation, TimerQueue::now(), [&] {
+        started = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        finished = true;
+    });
+    while (!started) std::this_thread::yield();
+
+    queue.newGeneration();
+    EXPECT_TRUE(finished);
+}
+
+TEST(TimerQueueTest, TasksCanScheduleAndSupersede) {
+    TimerQueue queue;
+    Recorder recorder;
+    uint64_t generation = queue.newGeneration();
+
+    queue.schedule(generation, TimerQueue::now(), [&] {
+        recorder.record(1);
+        queue.schedule(generation, TimerQueue::now(), [&] { recorder.record(2); });
+    });
+    ASSERT_TRUE(recorder.waitForRuns(2));
+
+    // Like a composition step calling off(), must not deadlock on the run lock
+    queue.schedule(generation, TimerQueue::now(), [&] {
+        uint64_t next = queue.newGeneration();
+        queue.schedule(next, TimerQueue::now(), [&] { recorder.record(3); });
+    });
+    ASSERT_TRUE(recorder.waitForRuns(3));
+}
+
+TEST(TimerQueueTest, VibrationsDoNotCreateThreads) {
+    TimerQueue queue;
+    Recorder recorder;
+    size_t threads = threadCount();
+
+    for (int i = 0; i < 100; i++) {
+        uint64_t generation = queue.newGeneration();
+        queue.schedule(generation, TimerQueue::now(), [&recorder, i] { recorder.record(i); });
+        ASSERT_TRUE(recorder.waitForRuns(i + 1));
+        EXPECT_EQ(threadCount(), threads);
+    }
+}
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "FakeNodes.h"
+#include "SysfsNode.h"
+#include "Vibrator.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+// From the perform() call until the last node write, which it returns after
+static void BM_PerformClick(benchmark::State& state) {
+    FakeNodes nodes;
+    std::shared_ptr<Vibrator> vibrator = nodes.makeVibrator();
+    int32_t durationMs;
+
+    for (auto _ : state) {
+        vibrator->perform(Effect::CLICK, EffectStrength::MEDIUM, nullptr, &durationMs);
+    }
+    vibrator->off();
+}
+BENCHMARK(BM_PerformClick);
+
+// A click alternating with a tick, so no write is skipped as unchanged
+static void BM_PerformClickThenTick(benchmark::State& state) {
+    FakeNodes nodes;
+    std::shared_ptr<Vibrator> vibrator = nodes.makeVibrator();
+    int32_t durationMs;
+
+    for (auto _ : state) {
+        vibrator->perform(Effect::CLICK, EffectStrength::STRONG, nullptr, &durationMs);
+        vibrator->perform(Effect::TICK, EffectStrength::LIGHT, nullptr, &durationMs);
+    }
+    vibrator->off();
+}
+BENCHMARK(BM_PerformClickThenTick);
+
+static void BM_SysfsNodeWrite(benchmark::State& state) {
+    FakeNodes nodes;
+    SysfsNode node(nodes.timeout().c_str());
+    int32_t value = 0;
+
+    for (auto _ : state) {
+        node.write(value++ & 0xff);
+    }
+}
+BENCHMARK(BM_SysfsNodeWrite);
+
+static void BM_SysfsNodeWriteIfUnchanged(benchmark::State& state) {
+    FakeNodes nodes;
+    SysfsNode node(nodes.timeout().c_str());
+    node.write(30);
+
+    for (auto _ : state) {
+        node.writeIfChanged(30);
+    }
+}
+BENCHMARK(BM_SysfsNodeWriteIfUnchanged);
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl
+
+BENCHMARK_MAIN();
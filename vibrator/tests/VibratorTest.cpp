@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include "FakeNodes.h"
+#include "Vibrator.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+TEST(VibratorTest, OffStopsTheMotor) {
+    FakeNodes nodes;
+    std::shared_ptr<Vibrator> vibrator = nodes.makeVibrator();
+
+    ASSERT_TRUE(vibrator->on(500, nullptr).isOk());
+    EXPECT_EQ(nodes.timeoutValue(), "500");
+
+    ASSERT_TRUE(vibrator->off().isOk());
+    EXPECT_EQ(nodes.timeoutValue(), "0");
+}
+
+TEST(VibratorTest, ShortTimeoutsAreRaisedToTheMinimum) {
+    FakeNodes nodes;
+    std::shared_ptr<Vibrator> vibrator = nodes.makeVibrator();
+
+    ASSERT_TRUE(vibrator->on(10, nullptr).isOk());
+    EXPECT_EQ(nodes.timeoutValue(), std::to_string(INTENSITY_MIN));
+    vibrator->off();
+}
+
+TEST(VibratorTest, PerformEndsWithTheEffectNotTheMinimum) {
+    FakeNodes nodes;
+    std::shared_ptr<Vibrator> vibrator = nodes.makeVibrator();
+    int32_t durationMs;
+
+    ASSERT_TRUE(vibrator->perform(Effect::CLICK, EffectStrength::MEDIUM, nullptr, &durationMs)
+                        .isOk());
+    ASSERT_TRUE(vibrator->off().isOk());
+    EXPECT_EQ(nodes.timeoutValue(), "0");
+}
+
+TEST(VibratorTest, FallbackDurationsIncludeTheMinimum) {
+    FakeNodes nodes;
+    std::shared_ptr<Vibrator> vibrator = nodes.makeVibrator();
+    int32_t durationMs;
+
+    // POP has no preset and a 15ms fallback
+    ASSERT_TRUE(vibrator->perform(Effect::POP, EffectStrength::MEDIUM, nullptr, &durationMs)
+                        .isOk());
+    EXPECT_EQ(durationMs, INTENSITY_MIN);
+    EXPECT_EQ(nodes.timeoutValue(), std::to_string(INTENSITY_MIN));
+    vibrator->off();
+}
+
+TEST(VibratorTest, OnPlaysAtTheLastAmplitude) {
+    FakeNodes nodes;
+    std::shared_ptr<Vibrator> vibrator = nodes.makeVibrator();
+
+    ASSERT_TRUE(vibrator->setAmplitude(0.5f).isOk());
+    std::string intensity = std::to_string(static_cast<uint32_t>(0.5f * INTENSITY_MAX));
+    EXPECT_EQ(nodes.intensityValue(), intensity);
+
+    // Re-arming always-on leaves the preset's intensity in the node
+    ASSERT_TRUE(vibrator->alwaysOnEnable(0, Effect::CLICK, EffectStrength::STRONG).isOk());
+    ASSERT_NE(nodes.intensityValue(), intensity);
+
+    ASSERT_TRUE(vibrator->on(500, nullptr).isOk());
+    EXPECT_EQ(nodes.intensityValue(), intensity);
+    vibrator->off();
+}
+
+TEST(VibratorTest, ExternalControlDisarmsAlwaysOn) {
+    FakeNodes nodes;
+    std::shared_ptr<Vibrator> vibrator = nodes.makeVibrator();
+
+    ASSERT_TRUE(vibrator->alwaysOnEnable(0, Effect::CLICK, EffectStrength::MEDIUM).isOk());
+    std::string cpTrigger = nodes.cpTriggerValue();
+    std::string intensity = nodes.intensityValue();
+    ASSERT_NE(cpTrigger, "0");
+
+    ASSERT_TRUE(vibrator->setExternalControl(true).isOk());
+    EXPECT_EQ(nodes.cpTriggerValue(), "0");
+    EXPECT_EQ(nodes.timeoutValue(), "0");
+
+    // Nothing re-arms it while audio holds the motor
+    vibrator->off();
+    EXPECT_EQ(nodes.cpTriggerValue(), "0");
+
+    // What audio leaves behind is rewritten on release, even if it is what was cached
+    nodes.setIntensity("1234");
+    ASSERT_TRUE(vibrator->setExternalControl(false).isOk());
+    EXPECT_EQ(nodes.cpTriggerValue(), cpTrigger);
+    EXPECT_EQ(nodes.intensityValue(), intensity);
+}
+
+} // namespace vibrator
+} // namespace hardware
+} // namespace android
+} // namespace aidl